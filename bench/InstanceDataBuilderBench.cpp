@@ -0,0 +1,101 @@
+// Compares the instance data builder with the straightforward per-instance
+// matrix multiplication it replaced.
+//
+//   InstanceDataBuilderBench [instanceCount] [iterations]
+
+#include "InstanceDataBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+namespace {
+
+std::vector<InstanceData>
+buildInstanceDataReference(const std::vector<Instance> &instances) {
+    std::vector<InstanceData> instanceData;
+    instanceData.reserve(instances.size());
+
+    for (const auto &instance : instances) {
+        InstanceData data;
+        data.transform = instance.getTransformMatrix();
+        data.textureIndices = instance.material.textureIds;
+        instanceData.push_back(data);
+    }
+
+    return instanceData;
+}
+
+std::vector<Instance> randomInstances(size_t count) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    std::vector<Instance> instances(count);
+    for (auto &instance : instances) {
+        instance.position = {position(random), position(random),
+                             position(random)};
+        instance.rotation = glm::normalize(
+            glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        instance.scale = {scale(random), scale(random), scale(random)};
+    }
+    return instances;
+}
+
+double bestOf(int iterations, const std::function<void()> &run) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+float maxDifference(const std::vector<InstanceData> &a,
+                    const std::vector<InstanceData> &b) {
+    float difference = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int column = 0; column < 4; column++) {
+            glm::vec4 delta =
+                glm::abs(a[i].transform[column] - b[i].transform[column]);
+            difference = std::max({difference, delta.x, delta.y, delta.z,
+                                   delta.w});
+        }
+    }
+    return difference;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    auto instances = randomInstances(count);
+    InstanceArrays arrays(instances);
+
+    std::vector<InstanceData> reference, fromInstances, fromArrays;
+    double referenceTime = bestOf(iterations, [&] {
+        reference = buildInstanceDataReference(instances);
+    });
+    double instancesTime = bestOf(
+        iterations, [&] { fromInstances = buildInstanceData(instances); });
+    double arraysTime =
+        bestOf(iterations, [&] { fromArrays = buildInstanceData(arrays); });
+
+    std::printf("%zu instances, best of %d runs\n", count, iterations);
+    std::printf("  reference (3 mat4 multiplies): %8.2f ms\n", referenceTime);
+    std::printf("  Instance vector:               %8.2f ms (%.1fx)\n",
+                instancesTime, referenceTime / instancesTime);
+    std::printf("  InstanceArrays:                %8.2f ms (%.1fx)\n",
+                arraysTime, referenceTime / arraysTime);
+    std::printf("  max difference: %g / %g\n",
+                maxDifference(reference, fromInstances),
+                maxDifference(reference, fromArrays));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GlmConfig.h"
+#include "commonstructs.h"
+#include <algorithm>
+#include <vector>
+
+struct BoundingBox {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+};
+
+struct BoundingSphere {
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+};
+
+inline BoundingBox computeBoundingBox(const std::vector<Vertex> &vertices) {
+    if (vertices.empty()) {
+        return {};
+    }
+
+    BoundingBox box{vertices[0].pos, vertices[0].pos};
+    for (const auto &vertex : vertices) {
+        box.min = glm::min(box.min, vertex.pos);
+        box.max = glm::max(box.max, vertex.pos);
+    }
+    return box;
+}
+
+// Sphere around the center of the bounding box. Not the tightest possible
+// sphere, but cheap and good enough for culling.
+inline BoundingSphere computeBoundingSphere(const std::vector<Vertex> &vertices,
+                                            const BoundingBox &box) {
+    BoundingSphere sphere;
+    sphere.center = box.center();
+    for (const auto &vertex : vertices) {
+        sphere.radius =
+            std::max(sphere.radius, glm::length(vertex.pos - sphere.center));
+    }
+    return sphere;
+}
+
+// Bounding sphere of a sphere transformed by a matrix that may scale
+// non-uniformly
+inline BoundingSphere transformSphere(const BoundingSphere &sphere,
+                                      const glm::mat4 &transform) {
+    float scale = std::max({glm::length(glm::vec3(transform[0])),
+                            glm::length(glm::vec3(transform[1])),
+                            glm::length(glm::vec3(transform[2]))});
+
+    BoundingSphere result;
+    result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * scale;
+    return result;
+}
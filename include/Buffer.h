@@ -10,7 +10,8 @@ class Buffer {
            VkMemoryPropertyFlags properties,
            VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_AUTO,
            VmaAllocationCreateFlagBits allocBits =
-               VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT);
+               VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT,
+           bool sharedWithTransferQueue = false);
 
     ~Buffer();
 
@@ -20,6 +21,10 @@ class Buffer {
 
     VkBuffer getBuffer() const { return buffer; }
 
+    // Concurrent buffers are accessible from the graphics and the transfer
+    // queue family at the same time and never need ownership transfers
+    bool isConcurrent() const { return concurrent; }
+
     void copyFrom(Buffer &srcBuffer, VkDeviceSize size);
 
     void copyToImage(VkImage image, uint32_t width, uint32_t height);
@@ -42,4 +47,5 @@ class Buffer {
     VkBuffer buffer;
     DeviceMemoryAllocationHandle allocation;
     bool bufferHasBeenMapped = false;
+    bool concurrent = false;
 };
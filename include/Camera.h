@@ -1,7 +1,6 @@
 #pragma once
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include "GlmConfig.h"
 
 // courtesy - learn opengl
 
@@ -13,6 +12,8 @@ const float SPEED = 1.5f;
 const float SENSITIVITYX = 0.1f;
 const float SENSITIVITYY = 0.2f;
 const float ZOOM = 45.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 1000.0f;
 
 class Camera {
   public:
@@ -103,6 +104,14 @@ class Camera {
 
     float getZoom() const { return Zoom; }
 
+    // Perspective projection for Vulkan clip space (y pointing down)
+    glm::mat4 getProjectionMatrix(float aspectRatio) const {
+        glm::mat4 projection = glm::perspective(
+            glm::radians(Zoom), aspectRatio, NEAR_PLANE, FAR_PLANE);
+        projection[1][1] *= -1;
+        return projection;
+    }
+
   private:
     void updateCameraVectors() {
         glm::vec3 front;
@@ -16,7 +16,12 @@ class CommandPool {
 
     VkCommandPool getCommandPool() const { return commandPool; }
 
-    std::vector<VkCommandBuffer> allocateCommandBuffers(uint32_t count);
+    std::vector<VkCommandBuffer> allocateCommandBuffers(
+        uint32_t count,
+        VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    // Returns every command buffer of the pool to the initial state
+    void reset();
 
   private:
     Device *device;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "DescriptorLayout.h"
+#include "Device.h"
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class ComputePipeline {
+  public:
+    ComputePipeline(Device *device, const std::string &shaderPath,
+                    const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                    uint32_t pushConstantSize,
+                    VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+
+    // Make uncopyable
+    ComputePipeline(const ComputePipeline &) = delete;
+    ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+    void cleanup();
+
+    VkPipeline getPipeline() const { return computePipeline; }
+    VkPipelineLayout getLayout() const { return pipelineLayout; }
+    DescriptorLayout &getDescriptorLayout() { return descriptorLayout; }
+
+  private:
+    Device *device;
+    VkPipeline computePipeline;
+    VkPipelineLayout pipelineLayout;
+    DescriptorLayout descriptorLayout;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include <cstdint>
+#include <vector>
+
+// Frustum culling on the CPU for devices and paths without GPU culling.
+// Instances are tested against the frustum, but only whole passes can be
+// skipped - a pass is drawn as soon as one of its instances is visible.
+//
+// The world-space spheres of all instances are kept as separate arrays of
+// coordinates so the per-instance test compiles down to vector code.
+class CpuCuller {
+  public:
+    // Spheres have to be added in the order of the passes
+    void addPass(const std::vector<BoundingSphere> &instanceSpheres);
+
+    // For instances that moved, firstInstance is relative to the pass
+    void updateSpheres(size_t passIndex, uint32_t firstInstance,
+                       const std::vector<BoundingSphere> &spheres);
+
+    void cull(const Frustum &frustum);
+
+    // Result of the last cull()
+    bool isVisible(size_t passIndex) const {
+        return visiblePasses[passIndex] != 0;
+    }
+
+    // Sphere around all instances of the pass, as of the last cull()
+    const BoundingSphere &getPassBounds(size_t passIndex) const {
+        return passes[passIndex].bounds;
+    }
+
+  private:
+    struct PassRange {
+        uint32_t first;
+        uint32_t count;
+        // encloses all instances of the pass
+        BoundingSphere bounds;
+        bool boundsDirty = false;
+    };
+
+    void updatePassBounds(PassRange &pass);
+    bool anyVisible(const PassRange &pass, const Frustum &frustum) const;
+
+    std::vector<PassRange> passes;
+    std::vector<uint8_t> visiblePasses;
+
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Destruction callbacks waiting for the GPU work that might still use their
+// objects. Each entry is tagged with a GPU timeline value and runs once that
+// value has been reached, in the order the entries were pushed.
+class DeletionQueue {
+  public:
+    DeletionQueue() = default;
+    ~DeletionQueue() = default;
+
+    DeletionQueue(const DeletionQueue &) = delete;
+    DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+    void push(uint64_t retireValue, std::function<void()> destroy);
+
+    // Runs every callback whose value is at most completedValue
+    void collect(uint64_t completedValue);
+
+    // Runs everything regardless of the GPU, only once the device is idle
+    void flush();
+
+    bool empty() const;
+
+  private:
+    struct Entry {
+        uint64_t retireValue;
+        std::function<void()> destroy;
+    };
+
+    // destroy callbacks may push more entries, so they run unlocked
+    bool popRetired(uint64_t completedValue, Entry &entry);
+
+    // retire values never decrease, the front retires first
+    std::deque<Entry> entries;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class Device;
+
+// Hands out descriptor sets from a growing list of pools. When the current
+// pool runs out a new, larger one is created, so callers never have to size
+// pools for what they are going to allocate. Sets live until they are freed
+// or until cleanup(), pools that run empty are destroyed.
+class DescriptorAllocator {
+  public:
+    DescriptorAllocator() = default;
+    ~DescriptorAllocator() = default;
+
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+    void init(Device *device);
+    void cleanup();
+
+    // descriptorCounts are the descriptors of each type one set needs, so a
+    // new pool is always big enough for the request. Returns the pool the
+    // sets were allocated from.
+    VkDescriptorPool allocate(
+        const std::vector<VkDescriptorSetLayout> &layouts,
+        const std::unordered_map<VkDescriptorType, uint32_t> &descriptorCounts,
+        VkDescriptorSet *sets);
+
+    // Gives the sets back to their pool once the frames that might bind them
+    // have retired
+    void free(VkDescriptorPool pool, std::vector<VkDescriptorSet> sets);
+
+  private:
+    static constexpr uint32_t INITIAL_SETS_PER_POOL = 64;
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    VkDescriptorPool createPool(
+        uint32_t maxSets,
+        const std::unordered_map<VkDescriptorType, uint32_t> &required);
+
+    Device *device = nullptr;
+    void freeNow(VkDescriptorPool pool,
+                 const std::vector<VkDescriptorSet> &sets);
+
+    std::vector<VkDescriptorPool> pools;
+    std::unordered_map<VkDescriptorPool, uint32_t> liveSets;
+    // expires with the pools, deferred frees check it before touching them
+    std::shared_ptr<int> poolsToken;
+    uint32_t nextPoolSize = INITIAL_SETS_PER_POOL;
+};
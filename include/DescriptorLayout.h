@@ -13,11 +13,17 @@ class DescriptorLayout {
         VkDevice device,
         std::vector<std::reference_wrapper<IAttachment>> attachments);
 
+    DescriptorLayout(VkDevice device,
+                     const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
     void cleanup();
 
     VkDescriptorSetLayout getLayout() const { return layout; }
 
   private:
+    void
+    createLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
     VkDevice device;
     VkDescriptorSetLayout layout;
 };
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "DescriptorAllocator.h"
 #include "DescriptorLayout.h"
 #include "DescriptorPool.h"
+#include <unordered_map>
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -9,9 +11,16 @@ class DescriptorSet {
   public:
     void init(VkDevice device, const DescriptorPool &pool,
               const DescriptorLayout &layout, uint32_t count);
+    // descriptorCounts holds the descriptors of each type in one set
+    void init(VkDevice device, DescriptorAllocator &allocator,
+              const DescriptorLayout &layout, uint32_t count,
+              const std::unordered_map<VkDescriptorType, uint32_t>
+                  &descriptorCounts);
 
-    void updateBufferInfo(size_t frameIndex, uint32_t binding, VkBuffer buffer,
-                          VkDeviceSize offset, VkDeviceSize range);
+    void updateBufferInfo(
+        size_t frameIndex, uint32_t binding, VkBuffer buffer,
+        VkDeviceSize offset, VkDeviceSize range,
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 
     void updateImageInfos(uint32_t startBinding,
                           const std::vector<VkImageView> &views,
@@ -23,7 +32,13 @@ class DescriptorSet {
 
     VkDescriptorSet getSet(uint32_t index) const;
 
+    // Returns sets from a DescriptorAllocator once the frames in flight are
+    // done with them
+    void release();
+
   private:
     VkDevice device;
     std::vector<VkDescriptorSet> descriptorSets;
+    DescriptorAllocator *allocator = nullptr;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+#include "DescriptorLayout.h"
+#include "DescriptorSet.h"
+#include "Device.h"
+#include "IAttachment.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Descriptor sets shared by everything drawn with the same layout and the
+// same attachment objects. The sets are written once when first requested and
+// allocated from a growing DescriptorAllocator, which is also available for
+// sets that aren't shared. Entries are reference counted and evicted when
+// their last user releases them.
+class DescriptorSetCache {
+  public:
+    DescriptorSetCache() = default;
+    ~DescriptorSetCache() = default;
+
+    DescriptorSetCache(const DescriptorSetCache &) = delete;
+    DescriptorSetCache &operator=(const DescriptorSetCache &) = delete;
+
+    void init(Device *device);
+    void cleanup();
+
+    DescriptorAllocator &getAllocator() { return allocator; }
+
+    // layoutKey identifies the layout, e.g. the id of the pipeline it belongs
+    // to. The attachments are identified by address, so they have to outlive
+    // every user of the set. Each get() has to be paired with a release().
+    const DescriptorSet &
+    get(uint64_t layoutKey, const DescriptorLayout &layout,
+        const std::vector<std::reference_wrapper<IAttachment>> &attachments,
+        uint32_t count);
+
+    // Evicts the entry once its last user is gone. Frames in flight may
+    // still bind the sets, they go back to their pool once those retire.
+    void release(const DescriptorSet &set);
+
+  private:
+    struct Key {
+        uint64_t layoutKey;
+        uint32_t count;
+        std::vector<const IAttachment *> attachments;
+
+        bool operator==(const Key &other) const {
+            return layoutKey == other.layoutKey && count == other.count &&
+                   attachments == other.attachments;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        std::unique_ptr<DescriptorSet> set;
+        uint32_t users = 0;
+    };
+
+    Device *device = nullptr;
+    DescriptorAllocator allocator;
+    std::unordered_map<Key, Entry, KeyHash> sets;
+    std::unordered_map<const DescriptorSet *, Key> keyOfSet;
+};
@@ -6,14 +6,19 @@
 #include "AppInstance.h"
 #include "AppWindow.h"
 #include "CommandPool.h"
+#include "DeletionQueue.h"
 #include "DeviceMemoryAllocation.h"
+#include "GpuTimeline.h"
 #include "commonstructs.h"
 
+class UploadContext;
+
 class Device {
     friend struct DeviceMemoryAllocationHandle;
 
   public:
-    void init(const AppWindow *appWindow, const AppInstance *appInstance);
+    void init(const AppWindow *appWindow, const AppInstance *appInstance,
+              uint32_t maxFramesInFlight);
 
     Device() = default;
 
@@ -41,6 +46,11 @@ class Device {
 
     VkResult submitToAvailablePresentQueue(const VkPresentInfoKHR *info) const;
 
+    // Goes to the dedicated transfer queue, or to the graphics queue when the
+    // device has none
+    VkResult submitToTransferQueue(const VkSubmitInfo *info,
+                                   VkFence submitFence) const;
+
     // TODO: move out this bunch into a separate abstraction
     uint32_t findMemoryType(uint32_t typeFilter,
                             VkMemoryPropertyFlags properties) const;
@@ -65,6 +75,9 @@ class Device {
     VkResult
     freeAllocationMemoryOnDemand(DeviceMemoryAllocationHandle *allocationInfo);
 
+    // Frees the allocation and its buffer or image through defer()
+    void freeAllocationMemoryDeferred(DeviceMemoryAllocationHandle allocation);
+
     VkResult mapMemory(DeviceMemoryAllocationHandle *allocationInfo,
                        void **ppData) const;
 
@@ -72,7 +85,41 @@ class Device {
 
     CommandPool *getGraphicsCommandPool() { return graphicsCommandPool; }
 
-    uint32_t getMaxFramesInFlight() const { return MAX_FRAMES_IN_FLIGHT; }
+    // nullptr when there is no dedicated transfer queue
+    CommandPool *getTransferCommandPool() { return transferCommandPool; }
+
+    bool hasDedicatedTransferQueue() const {
+        return queueFamilies.transferFamily.has_value();
+    }
+
+    uint32_t getGraphicsQueueFamily() const {
+        return queueFamilies.graphicsFamily.value();
+    }
+
+    uint32_t getTransferQueueFamily() const {
+        return queueFamilies.transferFamily.value_or(
+            queueFamilies.graphicsFamily.value());
+    }
+
+    UploadContext &getUploadContext() { return *uploadContext; }
+
+    // Completion counter of the frames submitted to the graphics queue
+    GpuTimeline &getTimeline() { return timeline; }
+
+    // Runs destroy once the frame being recorded and every frame submitted
+    // before it have retired, so objects can be released mid-session
+    // without idling the device
+    void defer(std::function<void()> destroy);
+
+    // Runs the deferred destructions of all retired frames
+    void collectDeferred();
+
+    // Features the logical device was created with
+    const VkPhysicalDeviceFeatures &getEnabledFeatures() const {
+        return enabledFeatures;
+    }
+
+    uint32_t getMaxFramesInFlight() const { return maxFramesInFlight; }
 
   private:
     void pickPhysicalDevice();
@@ -98,6 +145,9 @@ class Device {
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    QueueFamilyIndices queueFamilies;
+    VkPhysicalDeviceFeatures enabledFeatures{};
     VmaAllocator deviceMemoryAllocator;
 
     const AppWindow *appWindow;
@@ -105,10 +155,18 @@ class Device {
 
     CommandPool *graphicsCommandPool;
 
+    CommandPool *transferCommandPool = nullptr;
+
+    UploadContext *uploadContext;
+
+    GpuTimeline timeline;
+
+    DeletionQueue deletionQueue;
+
     std::unordered_map<AllocationIdentifier, DeviceMemoryAllocation,
                        AllocationIdentifier, AllocationIdentifier>
         allocations;
     unsigned long int allocationIdCounter{0}; // will overflow someday
 
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    uint32_t maxFramesInFlight = 0;
 };
@@ -19,12 +19,13 @@
 #include "CommandBuffer.h"
 #include "Device.h"
 #include "EnginePeripherals.h"
+#include "EngineSettings.h"
 #include "GlobalResources.h"
 #include "Render.h"
 
 class Engine {
   public:
-    Engine();
+    explicit Engine(const EngineSettings &settings = {});
 
     ~Engine() = default;
 
@@ -43,12 +44,25 @@ class Engine {
     GlobalResources &getGlobalResources() { return globalResources; }
     Device *getDevice() { return &appDevice; }
 
+    const EngineSettings &getSettings() const { return settings; }
+
+    // Recreates the swap chain, waiting for the device to go idle first
+    void setSwapChainSettings(const SwapChainSettings &swapChainSettings);
+    // The present mode actually in use, the first supported preference or
+    // FIFO
+    VkPresentModeKHR getPresentMode() {
+        return globalResources.getSwapChain().getPresentMode();
+    }
+
     TextureManager createTextureManager();
-    Renderable shaded(Model &model, PipelineSettings &settings);
+    Renderable shaded(Model &model, PipelineSettings &settings,
+                      const RenderableOptions &options = {});
 
     void initializeEngineTeardown();
 
   private:
+    EngineSettings settings;
+
     // order of destruction matters here. DO NOT CHANGE
 
     AppInstance appInstance;
@@ -69,7 +83,8 @@ class Engine {
 
     std::vector<VkSemaphore> renderFinishedSemaphores;
 
-    std::vector<VkFence> inFlightFences;
+    // timeline value of the last frame submitted from each frame slot
+    std::vector<uint64_t> frameCompletionValues;
 
     uint32_t currentFrame = 0;
 
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "SwapChainSettings.h"
+#include <cstdint>
+
+// Options fixed when the engine is created
+struct EngineSettings {
+    // Frames the CPU may record ahead of the GPU. Every per-frame resource
+    // (sync objects, command buffers, uniform buffers, descriptor sets) is
+    // created this many times. 1 gives the lowest input latency, 3 keeps a
+    // GPU-bound frame loop busy.
+    uint32_t framesInFlight = 2;
+
+    // Present mode preferences and image count, can be changed later with
+    // Engine::setSwapChainSettings
+    SwapChainSettings swapChain;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Bounds.h"
+#include "GlmConfig.h"
+#include <array>
+
+struct Frustum {
+    // Normalized planes, xyz is the inward facing normal and w the distance,
+    // in the order left, right, bottom, top, near, far
+    std::array<glm::vec4, 6> planes;
+
+    // Extracts the planes of a projection * view matrix with a [0, 1] depth
+    // range, the result is in world space
+    static Frustum fromMatrix(const glm::mat4 &viewProjection) {
+        // glm is column-major, so rows have to be gathered by hand
+        auto row = [&](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                             viewProjection[2][i], viewProjection[3][i]);
+        };
+
+        Frustum frustum;
+        frustum.planes[0] = row(3) + row(0);
+        frustum.planes[1] = row(3) - row(0);
+        frustum.planes[2] = row(3) + row(1);
+        frustum.planes[3] = row(3) - row(1);
+        frustum.planes[4] = row(2);
+        frustum.planes[5] = row(3) - row(2);
+
+        for (auto &plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    bool intersects(const glm::vec3 &center, float radius) const {
+        for (const auto &plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "ComputePipeline.h"
+#include "DescriptorSetCache.h"
 #include "Device.h"
 #include "MeshManager.h"
+#include "ParallelRecorder.h"
 #include "PipelineManager.h"
 #include "SwapChain.h"
+#include "ThreadPool.h"
 
 class GlobalResources {
   public:
@@ -11,16 +15,28 @@ class GlobalResources {
 
     ~GlobalResources();
 
-    void init(Device *device, AppWindow *appWindow);
+    void init(Device *device, AppWindow *appWindow,
+              const SwapChainSettings &swapChainSettings = {});
 
     SwapChain &getSwapChain() { return *swapChain; }
     PipelineManager &getPipelineManager() { return pipelineManager; }
     MeshManager &getMeshManager() { return meshManager; }
+    DescriptorSetCache &getDescriptorSets() { return descriptorSets; }
+    ParallelRecorder &getParallelRecorder() { return parallelRecorder; }
+    // Created on first use, needs shaders/cull.spv
+    ComputePipeline &getCullingPipeline();
     Device *getDevice() { return device; }
+    // Worker threads shared by pipeline compilation, parallel recording and
+    // instance data building. One hardware thread is left to the caller.
+    ThreadPool &getThreads() { return *threads; }
 
   private:
     Device *device = nullptr;
+    std::unique_ptr<ThreadPool> threads;
     PipelineManager pipelineManager;
     MeshManager meshManager;
+    DescriptorSetCache descriptorSets;
+    ParallelRecorder parallelRecorder;
     std::unique_ptr<SwapChain> swapChain;
+    std::unique_ptr<ComputePipeline> cullingPipeline;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+class Device;
+
+// Timeline semaphore counting finished GPU work. Every frame submission
+// signals the next value, so a value reached means that frame and all work
+// submitted to the graphics queue before it have retired.
+class GpuTimeline {
+  public:
+    GpuTimeline() = default;
+    ~GpuTimeline() = default;
+
+    GpuTimeline(const GpuTimeline &) = delete;
+    GpuTimeline &operator=(const GpuTimeline &) = delete;
+
+    void init(Device *device);
+    void cleanup();
+
+    VkSemaphore getSemaphore() const { return semaphore; }
+
+    // Reserves the value the next submission signals. Values have to be
+    // signaled in the order they were reserved.
+    uint64_t advance() { return ++lastSubmitted; }
+
+    uint64_t getLastSubmitted() const { return lastSubmitted; }
+
+    // Highest value the GPU has signaled so far
+    uint64_t getCompleted();
+
+    bool isComplete(uint64_t value);
+
+    void wait(uint64_t value);
+
+  private:
+    Device *device = nullptr;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    uint64_t lastSubmitted = 0;
+    // cached so polling completed values skips the driver call
+    uint64_t lastCompleted = 0;
+};
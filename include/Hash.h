@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Incremental 64-bit FNV-1a. Fast enough for content keys and checksums,
+// not meant to resist deliberate collisions.
+class Hasher {
+  public:
+    void add(const void *data, size_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            value ^= bytes[i];
+            value *= 0x100000001b3ull;
+        }
+    }
+
+    // Only for types without padding, hash struct members one by one
+    template <typename T> void add(const T &data) {
+        static_assert(std::is_integral_v<T> || std::is_enum_v<T> ||
+                          std::is_floating_point_v<T>,
+                      "hash the members of compound types individually");
+        add(&data, sizeof(data));
+    }
+
+    template <typename T> void add(const std::vector<T> &data) {
+        static_assert(std::is_arithmetic_v<T>,
+                      "hash the members of compound types individually");
+        add(data.size());
+        add(data.data(), data.size() * sizeof(T));
+    }
+
+    uint64_t get() const { return value; }
+
+  private:
+    uint64_t value = 0xcbf29ce484222325ull;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Instance.h"
+#include "MaterialInstance.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Structure-of-arrays layout of a list of Instances. Every component lives in
+// its own tightly packed array, so the instance data builder can load four
+// instances' worth of a component with a single SIMD load, and bulk
+// transforms only touch the arrays they change.
+//
+// operator[], set() and toInstances() give an Instance (AoS) view for code
+// that works with single instances.
+struct InstanceArrays {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<std::array<int32_t, MAX_TEXTURES_PER_MATERIAL>> textureIds;
+
+    InstanceArrays() = default;
+    explicit InstanceArrays(const std::vector<Instance> &instances) {
+        reserve(instances.size());
+        for (const auto &instance : instances) {
+            push_back(instance);
+        }
+    }
+
+    size_t size() const { return positionX.size(); }
+    bool empty() const { return positionX.empty(); }
+
+    void reserve(size_t count) {
+        for (auto array : floatArrays()) {
+            array->reserve(count);
+        }
+        textureIds.reserve(count);
+    }
+
+    void push_back(const Instance &instance) {
+        positionX.push_back(instance.position.x);
+        positionY.push_back(instance.position.y);
+        positionZ.push_back(instance.position.z);
+        rotationX.push_back(instance.rotation.x);
+        rotationY.push_back(instance.rotation.y);
+        rotationZ.push_back(instance.rotation.z);
+        rotationW.push_back(instance.rotation.w);
+        scaleX.push_back(instance.scale.x);
+        scaleY.push_back(instance.scale.y);
+        scaleZ.push_back(instance.scale.z);
+        textureIds.push_back(instance.material.textureIds);
+    }
+
+    void append(const InstanceArrays &other) {
+        auto arrays = floatArrays();
+        auto otherArrays = other.floatArrays();
+        for (size_t i = 0; i < arrays.size(); i++) {
+            arrays[i]->insert(arrays[i]->end(), otherArrays[i]->begin(),
+                              otherArrays[i]->end());
+        }
+        textureIds.insert(textureIds.end(), other.textureIds.begin(),
+                          other.textureIds.end());
+    }
+
+    void translate(const glm::vec3 &offset) {
+        for (auto &x : positionX) {
+            x += offset.x;
+        }
+        for (auto &y : positionY) {
+            y += offset.y;
+        }
+        for (auto &z : positionZ) {
+            z += offset.z;
+        }
+    }
+
+    // Scales positions and sizes uniformly
+    void scale(float factor) {
+        for (auto array : {&positionX, &positionY, &positionZ, &scaleX,
+                           &scaleY, &scaleZ}) {
+            for (auto &value : *array) {
+                value *= factor;
+            }
+        }
+    }
+
+    void set(size_t index, const Instance &instance) {
+        positionX[index] = instance.position.x;
+        positionY[index] = instance.position.y;
+        positionZ[index] = instance.position.z;
+        rotationX[index] = instance.rotation.x;
+        rotationY[index] = instance.rotation.y;
+        rotationZ[index] = instance.rotation.z;
+        rotationW[index] = instance.rotation.w;
+        scaleX[index] = instance.scale.x;
+        scaleY[index] = instance.scale.y;
+        scaleZ[index] = instance.scale.z;
+        textureIds[index] = instance.material.textureIds;
+    }
+
+    std::vector<Instance> toInstances() const {
+        std::vector<Instance> instances;
+        instances.reserve(size());
+        for (size_t i = 0; i < size(); i++) {
+            instances.push_back((*this)[i]);
+        }
+        return instances;
+    }
+
+    Instance operator[](size_t index) const {
+        Instance instance;
+        instance.position = {positionX[index], positionY[index],
+                             positionZ[index]};
+        instance.rotation = glm::quat(rotationW[index], rotationX[index],
+                                      rotationY[index], rotationZ[index]);
+        instance.scale = {scaleX[index], scaleY[index], scaleZ[index]};
+        instance.material.textureIds = textureIds[index];
+        return instance;
+    }
+
+    // Replaces every instance with offsets.size() copies of it, each moved by
+    // one of the offsets. Works in place: the arrays grow once and are filled
+    // back to front, so no source value is overwritten before it is copied.
+    void scatter(const std::vector<glm::vec3> &offsets) {
+        size_t count = size();
+        size_t copies = offsets.size();
+        if (copies == 0) {
+            *this = {};
+            return;
+        }
+
+        for (auto array : floatArrays()) {
+            array->resize(count * copies);
+            for (size_t i = count; i-- > 0;) {
+                float value = (*array)[i];
+                std::fill_n(array->begin() + i * copies, copies, value);
+            }
+        }
+        textureIds.resize(count * copies);
+        for (size_t i = count; i-- > 0;) {
+            auto value = textureIds[i];
+            std::fill_n(textureIds.begin() + i * copies, copies, value);
+        }
+
+        for (size_t i = 0; i < count * copies; i++) {
+            const auto &offset = offsets[i % copies];
+            positionX[i] += offset.x;
+            positionY[i] += offset.y;
+            positionZ[i] += offset.z;
+        }
+    }
+
+  private:
+    std::array<std::vector<float> *, 10> floatArrays() {
+        return {&positionX, &positionY, &positionZ, &rotationX, &rotationY,
+                &rotationZ, &rotationW, &scaleX,    &scaleY,    &scaleZ};
+    }
+
+    std::array<const std::vector<float> *, 10> floatArrays() const {
+        return {&positionX, &positionY, &positionZ, &rotationX, &rotationY,
+                &rotationZ, &rotationW, &scaleX,    &scaleY,    &scaleZ};
+    }
+};
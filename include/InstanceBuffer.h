@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Device.h"
+#include "InstanceData.h"
+#include <memory>
+#include <vector>
+
+// GPU instance data of a Renderable. Static buffers live in device local
+// memory and never change. Dynamic ones keep a CPU copy of the instances and
+// a persistently mapped buffer per frame in flight; updates only touch the
+// CPU copy and are written to a frame's buffer right before it is rendered.
+class InstanceBuffer {
+  public:
+    InstanceBuffer(Device *device, const std::vector<InstanceData> &instances,
+                   bool dynamic, uint32_t maxFramesInFlight);
+    ~InstanceBuffer() = default;
+
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    VkBuffer getBuffer(uint32_t frameIndex) const {
+        return buffers[dynamic ? frameIndex : 0]->getBuffer();
+    }
+
+    uint32_t getInstanceCount() const { return instanceCount; }
+    bool isDynamic() const { return dynamic; }
+
+    // Only allowed for dynamic buffers
+    void update(uint32_t firstInstance, const InstanceData *data,
+                uint32_t count);
+
+    // Writes everything updated since the frame's buffer was last flushed.
+    // The GPU must be done with the frame's previous use of the buffer.
+    void flush(uint32_t frameIndex);
+
+    // Instances [begin, end) that a frame's buffer has not seen yet
+    struct DirtyRange {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+  private:
+    uint32_t instanceCount;
+    bool dynamic;
+
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    // Dynamic mode only
+    std::vector<InstanceData> instances;
+    std::vector<InstanceData *> mappedBuffers;
+    std::vector<std::vector<DirtyRange>> dirtyRanges;
+};
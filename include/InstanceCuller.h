@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Buffer.h"
+#include "DescriptorSet.h"
+#include "Frustum.h"
+#include "GlmConfig.h"
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class GlobalResources;
+
+struct CullPushConstants {
+    glm::vec4 planes[6];
+    uint32_t instanceCount;
+};
+
+// GPU frustum culling of a Renderable's instances. Every frame a compute pass
+// copies the visible instances into a per-frame instance buffer, compacted
+// within the range of their draw, and writes the matching instance counts
+// into a per-frame copy of the indirect commands.
+class InstanceCuller {
+  public:
+    // instanceBuffers holds the source instances of every frame in flight,
+    // drawOfInstance maps every instance to the index of its command,
+    // drawBounds holds the mesh bounding sphere of every command
+    InstanceCuller(GlobalResources *resources,
+                   const std::vector<VkBuffer> &instanceBuffers,
+                   const std::vector<VkDrawIndexedIndirectCommand> &commands,
+                   const std::vector<uint32_t> &drawOfInstance,
+                   const std::vector<glm::vec4> &drawBounds,
+                   uint32_t maxFramesInFlight);
+    ~InstanceCuller();
+
+    InstanceCuller(const InstanceCuller &) = delete;
+    InstanceCuller &operator=(const InstanceCuller &) = delete;
+
+    static std::vector<VkDescriptorSetLayoutBinding> layoutBindings();
+
+    // Has to be recorded outside of a rendering scope
+    void record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                const Frustum &frustum);
+
+    VkBuffer getIndirectBuffer(uint32_t frameIndex) const {
+        return indirectBuffers[frameIndex]->getBuffer();
+    }
+    VkBuffer getInstanceBuffer(uint32_t frameIndex) const {
+        return visibleInstanceBuffers[frameIndex]->getBuffer();
+    }
+
+  private:
+    std::unique_ptr<Buffer> createDeviceBuffer(VkDeviceSize size,
+                                               VkBufferUsageFlags usage);
+
+    GlobalResources *resources;
+    uint32_t instanceCount;
+    VkDeviceSize commandsSize;
+
+    std::unique_ptr<Buffer> drawOfInstanceBuffer;
+    std::unique_ptr<Buffer> drawBoundsBuffer;
+    // the commands with all instance counts set to zero
+    std::unique_ptr<Buffer> resetCommandsBuffer;
+
+    std::vector<std::unique_ptr<Buffer>> indirectBuffers;
+    std::vector<std::unique_ptr<Buffer>> visibleInstanceBuffers;
+
+    DescriptorSet descriptorSet;
+};
@@ -1,9 +1,26 @@
 #pragma once
 
 #include "Instance.h"
+#include "InstanceArrays.h"
 #include "InstanceData.h"
+#include "ThreadPool.h"
 #include <vector>
 
-// Converts high-level Instance objects into GPU-ready InstanceData
+// Converts high-level Instance objects into GPU-ready InstanceData.
+//
+// The transform is composed directly from translation, rotation and scale
+// instead of multiplying three full matrices. Large inputs are split across
+// the threads of the pool and the calling thread, which must not be one of
+// the pool's workers. Without a pool threads are started for the call.
 std::vector<InstanceData>
-buildInstanceData(const std::vector<Instance> &instances);
+buildInstanceData(const std::vector<Instance> &instances,
+                  ThreadPool *threads = nullptr);
+
+// Same as above for the structure-of-arrays layout, which additionally lets
+// four instances be composed at once with SSE where it is available
+std::vector<InstanceData> buildInstanceData(const InstanceArrays &instances,
+                                            ThreadPool *threads = nullptr);
+
+// Writes the InstanceData of instances [first, first + count) to output
+void buildInstanceData(const InstanceArrays &instances, size_t first,
+                       size_t count, InstanceData *output);
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "Bounds.h"
 #include "Buffer.h"
 #include "Device.h"
+#include "OffsetAllocator.h"
 #include "commonstructs.h"
 #include <memory>
 #include <unordered_map>
@@ -9,10 +11,33 @@
 
 using MeshID = uint32_t;
 
+enum class MeshStorage {
+    // every mesh gets its own vertex and index buffer
+    Dedicated,
+    // meshes are sub-allocated from a few large vertex and index buffers
+    Shared,
+};
+
 struct Mesh {
-    std::unique_ptr<Buffer> vertexBuffer;
-    std::unique_ptr<Buffer> indexBuffer;
-    uint32_t indexCount;
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    int32_t vertexOffset = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    // In mesh space
+    BoundingBox box;
+    BoundingSphere bounds;
+
+    // Only set for dedicated storage
+    std::unique_ptr<Buffer> ownedVertexBuffer;
+    std::unique_ptr<Buffer> ownedIndexBuffer;
+
+    // Location inside the shared blocks, needed to free the ranges again
+    size_t vertexBlock = 0;
+    size_t indexBlock = 0;
+    VkDeviceSize vertexRangeSize = 0;
+    VkDeviceSize indexRangeSize = 0;
 };
 
 class MeshManager {
@@ -23,16 +48,51 @@ class MeshManager {
     MeshManager(const MeshManager &) = delete;
     MeshManager &operator=(const MeshManager &) = delete;
 
-    void init(Device *device);
+    void init(Device *device, MeshStorage storage = MeshStorage::Shared);
     void cleanup();
 
     MeshID registerMesh(const std::vector<Vertex> &vertices,
                         const std::vector<uint16_t> &indices);
 
+    // Stored as 16-bit indices whenever every index fits
+    MeshID registerMesh(const std::vector<Vertex> &vertices,
+                        const std::vector<uint32_t> &indices);
+
+    // Frames in flight may still draw the mesh, its storage is only reused
+    // once they have retired
+    void unregisterMesh(MeshID id);
+
     const Mesh *getMesh(MeshID id) const;
 
   private:
+    struct Block {
+        std::unique_ptr<Buffer> buffer;
+        OffsetAllocator allocator;
+    };
+
+    MeshID registerMesh(const std::vector<Vertex> &vertices,
+                        const void *indexData, uint32_t indexCount,
+                        VkIndexType indexType);
+
+    void placeDedicated(Mesh &mesh, VkDeviceSize vertexBytes,
+                        VkDeviceSize indexBytes);
+    void placeShared(Mesh &mesh, VkDeviceSize vertexBytes,
+                     VkDeviceSize indexBytes, VkDeviceSize indexStride);
+
+    // Returns the index of the block and the offset inside of it
+    size_t allocateFromBlocks(std::vector<Block> &blocks,
+                              VkDeviceSize blockSize, VkBufferUsageFlags usage,
+                              VkDeviceSize size, VkDeviceSize alignment,
+                              VkDeviceSize &offset);
+
     Device *device = nullptr;
+    MeshStorage storage = MeshStorage::Shared;
     std::unordered_map<MeshID, std::unique_ptr<Mesh>> meshes;
     MeshID nextMeshId = 0;
+
+    std::vector<Block> vertexBlocks;
+    std::vector<Block> indexBlocks;
+    // expires with the blocks, deferred range frees check it before
+    // touching them
+    std::shared_ptr<int> blocksToken;
 };
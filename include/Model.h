@@ -2,21 +2,40 @@
 
 #include "RenderBatch.h"
 #include <cstring>
+#include <unordered_map>
 #include <vector>
 
+// A set of render batches with at most one batch per mesh. Batches are
+// indexed by mesh, so merging models and adding batches take constant time
+// per batch.
 class Model {
   public:
     Model() = default;
 
+    // Appends the instances to the existing batch of the same mesh if there
+    // is one
     void addBatch(RenderBatch &&batch);
 
+    // Preallocates room for batchCount batches in total. Call it once before
+    // merging many models, the merges don't reserve on their own.
+    void reserve(size_t batchCount);
+
     Model merge(Model &other) const;
+    // In-place variants, the second one moves the other model's batches
+    // instead of copying them
+    void mergeFrom(const Model &other);
+    void mergeFrom(Model &&other);
+
     void scale(float factor);
     void translate(const glm::vec3 &offset);
     void scatter(const std::vector<glm::vec3> &offsets);
 
+    // The mesh of a batch must not be changed through this, the index relies
+    // on it
     std::vector<RenderBatch> &getBatches() { return batches; }
+    const std::vector<RenderBatch> &getBatches() const { return batches; }
 
   private:
     std::vector<RenderBatch> batches;
+    std::unordered_map<MeshID, size_t> batchOfMesh;
 };
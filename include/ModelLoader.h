@@ -22,7 +22,9 @@ class ModelLoader {
 
     struct ProcessedPrimitive {
         std::vector<Vertex> vertices;
-        std::vector<uint16_t> indices;
+        // Merged primitives easily exceed the 16-bit range, MeshManager
+        // narrows them again when possible
+        std::vector<uint32_t> indices;
         int32_t materialIndex = -1;
     };
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Free-list sub-allocator for ranges of a larger resource. It only does the
+// bookkeeping; the memory itself is owned by whoever uses the offsets.
+// Adjacent free ranges are merged again when freed.
+class OffsetAllocator {
+  public:
+    OffsetAllocator() = default;
+    explicit OffsetAllocator(uint64_t capacity);
+
+    // First-fit allocation, alignment doesn't have to be a power of two.
+    // Returns false when no free range is large enough.
+    bool allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+
+    // size has to match the size passed to allocate()
+    void free(uint64_t offset, uint64_t size);
+
+    uint64_t getCapacity() const { return capacity; }
+    uint64_t getFreeSpace() const { return freeSpace; }
+
+  private:
+    uint64_t capacity = 0;
+    uint64_t freeSpace = 0;
+    // offset -> size of every free range
+    std::map<uint64_t, uint64_t> freeRanges;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CommandPool.h"
+#include "Device.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Secondary command buffers for recording a frame's draws in parallel on the
+// engine's worker threads, one chunk per worker. Every chunk has its own
+// command pool per frame in flight, so chunks never share a pool while
+// recording and a frame's pools can be reset as a whole once the frame has
+// retired.
+class ParallelRecorder {
+  public:
+    ParallelRecorder() = default;
+    ~ParallelRecorder() = default;
+
+    ParallelRecorder(const ParallelRecorder &) = delete;
+    ParallelRecorder &operator=(const ParallelRecorder &) = delete;
+
+    // Records on the engine's shared worker threads
+    void init(Device *device, ThreadPool &threads, uint32_t maxFramesInFlight);
+    void cleanup();
+
+    // Upper limit for the chunks of one frame
+    size_t getChunkCount() const { return chunkCount; }
+    ThreadPool &getThreads() { return *threads; }
+
+    // Resets the secondary command buffers of the frame. The frame's previous
+    // submission has to be complete.
+    void beginFrame(uint32_t frameIndex);
+
+    // Begins the chunk's secondary command buffer for drawing inside a
+    // dynamic rendering scope with the given attachments
+    VkCommandBuffer beginChunk(uint32_t frameIndex, size_t chunk,
+                               VkFormat colorFormat, VkFormat depthFormat);
+
+  private:
+    Device *device = nullptr;
+    size_t chunkCount = 0;
+    ThreadPool *threads = nullptr;
+    // indexed by frame, then chunk
+    std::vector<std::vector<std::unique_ptr<CommandPool>>> pools;
+    std::vector<std::vector<VkCommandBuffer>> commandBuffers;
+};
@@ -10,9 +10,14 @@
 
 class Pipeline {
   public:
+    // The shaders are passed as SPIR-V, PipelineManager already loaded them
+    // to compute the pipeline id
     Pipeline(Device *device, DescriptorLayout descriptorLayout,
              VkFormat colorFormat, VkFormat depthFormat,
-             uint32_t maxFramesInFlight, PipelineSettings &settings);
+             uint32_t maxFramesInFlight, const PipelineSettings &settings,
+             const std::vector<char> &vertexShaderCode,
+             const std::vector<char> &fragmentShaderCode,
+             VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 
     // Make uncopyable
     Pipeline(const Pipeline &) = delete;
@@ -22,24 +27,16 @@ class Pipeline {
 
     VkPipeline getPipeline() const { return graphicsPipeline; }
     VkPipelineLayout getLayout() const { return pipelineLayout; }
-    const std::vector<std::reference_wrapper<IAttachment>> &
-    getAttachments() const {
-        return attachments;
-    }
-
-    void bind(IAttachment &attachment) { attachments.push_back(attachment); }
     DescriptorLayout &getDescriptorLayout() { return descriptorLayout; }
 
-    void prepareForRendering() const;
+    // Shared with ComputePipeline
+    static std::vector<char> readFile(const std::string &filename);
+    static VkShaderModule createShaderModule(VkDevice device,
+                                             const std::vector<char> &code);
 
   private:
     Device *device;
     VkPipeline graphicsPipeline;
     VkPipelineLayout pipelineLayout;
     DescriptorLayout descriptorLayout;
-
-    std::vector<std::reference_wrapper<IAttachment>> attachments;
-
-    VkShaderModule createShaderModule(const std::vector<char> &code);
-    std::vector<char> readFile(const std::string &filename);
 };
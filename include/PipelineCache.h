@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Device.h"
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// VkPipelineCache that survives process restarts. The cache data is stored
+// after a small header identifying the device and driver that produced it;
+// a file written by a different GPU or driver version is ignored and the
+// cache starts out empty.
+class PipelineCache {
+  public:
+    PipelineCache() = default;
+    ~PipelineCache() = default;
+
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    void init(Device *device, const std::string &path);
+    // Writes the cache back to disk and destroys it
+    void cleanup();
+
+    VkPipelineCache getCache() const { return cache; }
+
+  private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    FileHeader expectedHeader() const;
+    std::vector<char> load() const;
+    void save() const;
+
+    Device *device = nullptr;
+    std::string path;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+};
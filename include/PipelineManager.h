@@ -2,14 +2,36 @@
 
 #include "Device.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
 #include "PipelineSettings.h"
+#include "ThreadPool.h"
+#include <future>
 #include <memory>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.h>
 
-using PipelineID = std::string;
+// Hash of everything that makes up a pipeline: SPIR-V contents, vertex input
+// layout, descriptor layout, attachment formats and fixed-function state.
+// Settings that only differ in shader paths or bound attachment objects share
+// one pipeline.
+using PipelineID = uint64_t;
 
+// Everything needed to create one pipeline asynchronously
+struct PipelineRequest {
+    DescriptorLayout descriptorLayout;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    uint32_t maxFramesInFlight;
+    PipelineSettings settings;
+};
+
+// Pipelines are compiled on the engine's worker threads,
+// vkCreateGraphicsPipelines may be called concurrently. Creating a pipeline
+// only schedules the work and returns its id; getPipeline waits for it to
+// finish.
 class PipelineManager {
   public:
     PipelineManager() = default;
@@ -18,17 +40,76 @@ class PipelineManager {
     PipelineManager(const PipelineManager &) = delete;
     PipelineManager &operator=(const PipelineManager &) = delete;
 
-    void init(Device *device);
+    // Pipelines are created through a cache stored at cachePath, relative to
+    // the working directory like the shaders
+    void init(Device *device, ThreadPool &threads,
+              const std::string &cachePath = "pipeline_cache.bin");
+    // Also writes the pipeline cache to disk
     void cleanup();
 
+    // Blocks until the pipeline is created, rethrows creation errors
     PipelineID createPipeline(DescriptorLayout descriptorLayout,
                               VkFormat colorFormat, VkFormat depthFormat,
                               uint32_t maxFramesInFlight,
                               PipelineSettings &settings);
 
+    PipelineID createPipelineAsync(DescriptorLayout descriptorLayout,
+                                   VkFormat colorFormat, VkFormat depthFormat,
+                                   uint32_t maxFramesInFlight,
+                                   const PipelineSettings &settings);
+
+    // Schedules all requests at once, the ids are in request order
+    std::vector<PipelineID>
+    createPipelines(std::vector<PipelineRequest> requests);
+
+    bool isReady(const PipelineID &id) const;
+    void waitAll() const;
+
+    // Waits for the pipeline if it is still being created. Rethrows the
+    // error if its creation failed.
     Pipeline &getPipeline(const PipelineID &id) const;
 
+    VkPipelineCache getPipelineCache() const { return cache.getCache(); }
+
   private:
+    using PendingPipeline = std::shared_future<std::shared_ptr<Pipeline>>;
+
+    // Ids are only hashes, each entry keeps the full key to tell apart
+    // pipelines whose hashes collide
+    struct Entry {
+        std::vector<char> vertexShaderCode;
+        std::vector<char> fragmentShaderCode;
+        std::vector<uint64_t> state;
+        PendingPipeline pipeline;
+    };
+
+    // Shader paths plus state, checked before the SPIR-V is read from disk
+    struct SourceKey {
+        std::string vertexShaderPath;
+        std::string fragmentShaderPath;
+        std::vector<uint64_t> state;
+
+        bool operator==(const SourceKey &other) const {
+            return vertexShaderPath == other.vertexShaderPath &&
+                   fragmentShaderPath == other.fragmentShaderPath &&
+                   state == other.state;
+        }
+    };
+    struct SourceKeyHash {
+        size_t operator()(const SourceKey &key) const;
+    };
+
+    const PendingPipeline &find(const PipelineID &id) const;
+
+    // Vertex input layout, descriptor layout, attachment formats and
+    // fixed-function state flattened into one list
+    static std::vector<uint64_t> stateKey(const PipelineSettings &settings,
+                                          VkFormat colorFormat,
+                                          VkFormat depthFormat);
+
     Device *device = nullptr;
-    std::unordered_map<PipelineID, std::unique_ptr<Pipeline>> pipelines;
+    PipelineCache cache;
+    ThreadPool *compileThreads = nullptr;
+    std::unordered_map<PipelineID, Entry> pipelines;
+    std::unordered_map<SourceKey, PipelineID, SourceKeyHash> sources;
 };
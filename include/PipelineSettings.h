@@ -5,6 +5,49 @@
 #include <string>
 #include <vector>
 
+// Where the compiled SPIR-V is loaded from. The CMake build points this at
+// its own output when it compiles the shaders.
+#ifndef SHADER_DIR
+#define SHADER_DIR "shaders/"
+#endif
+
+// Fixed-function state of a pipeline. The defaults match what every pipeline
+// used before this was configurable: alpha blending, back-face culling and a
+// LESS depth test with writes.
+struct PipelineState {
+    bool blendEnable = true;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    bool depthTestEnable = true;
+    bool depthWriteEnable = true;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    VkColorComponentFlags colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    // No blending. Also the right choice for alpha-tested geometry, which
+    // discards in the fragment shader instead of blending.
+    static PipelineState opaque() {
+        PipelineState state;
+        state.blendEnable = false;
+        return state;
+    }
+
+    // Translucent geometry: blended, tested against but not writing depth
+    static PipelineState blended() {
+        PipelineState state;
+        state.depthWriteEnable = false;
+        return state;
+    }
+
+    // Only fills the depth buffer, for a depth pre-pass
+    static PipelineState depthOnly() {
+        PipelineState state;
+        state.blendEnable = false;
+        state.colorWriteMask = 0;
+        return state;
+    }
+};
+
 class PipelineSettings {
   public:
     PipelineSettings(std::string vertexShaderPath,
@@ -17,11 +60,20 @@ class PipelineSettings {
     std::vector<std::reference_wrapper<IAttachment>> &getAttachments() {
         return attachments;
     }
-    std::string getVertexShaderPath() { return vertexShaderPath; }
-    std::string getFragmentShaderPath() { return fragmentShaderPath; }
+    const std::vector<std::reference_wrapper<IAttachment>> &
+    getAttachments() const {
+        return attachments;
+    }
+    std::string getVertexShaderPath() const { return vertexShaderPath; }
+    std::string getFragmentShaderPath() const { return fragmentShaderPath; }
+
+    void setState(const PipelineState &state) { this->state = state; }
+    PipelineState &getState() { return state; }
+    const PipelineState &getState() const { return state; }
 
   private:
     std::string vertexShaderPath;
     std::string fragmentShaderPath;
     std::vector<std::reference_wrapper<IAttachment>> attachments;
+    PipelineState state;
 };
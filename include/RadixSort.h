@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Stable LSD radix sort by key, one byte per pass. Passes over a byte that is
+// the same in every key are skipped, so keys that only use a few of their
+// bits sort in fewer passes. scratch is reused between calls to avoid
+// allocating every frame.
+void radixSort(std::vector<SortEntry> &entries,
+               std::vector<SortEntry> &scratch);
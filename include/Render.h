@@ -1,8 +1,13 @@
 #pragma once
 
 #include "Camera.h"
+#include "Frustum.h"
+#include "RadixSort.h"
 #include "GlobalResources.h"
+#include "RenderStateTracker.h"
 #include "Renderable.h"
+#include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 class Render {
@@ -10,8 +15,7 @@ class Render {
     Render(GlobalResources *globalResources, VkCommandBuffer commandBuffer,
            uint32_t imageIndex, uint32_t currentFrame,
            VkSemaphore imageAvailableSemaphore,
-           VkSemaphore renderFinishedSemaphore, VkFence inFlightFence,
-           Camera &camera);
+           VkSemaphore renderFinishedSemaphore, Camera &camera);
     ~Render() = default;
 
     // Prevent copying
@@ -21,6 +25,21 @@ class Render {
     void submit(Renderable &renderable);
     bool finish();
 
+    // Timeline value signaled once the frame's commands have executed, zero
+    // before finish()
+    uint64_t getCompletionValue() const { return completionValue; }
+
+    // On by default: the draws of all submitted renderables are sorted by
+    // pipeline, descriptor set and mesh buffers to minimize state changes,
+    // opaque ones front to back and translucent ones back to front. Off
+    // records them in submission order.
+    void setDrawSorting(bool enabled) { sortDraws = enabled; }
+
+    // On by default: frames with enough draws are split into chunks of
+    // consecutive sorted draws, recorded on worker threads into secondary
+    // command buffers and executed in order by the primary one
+    void setParallelRecording(bool enabled) { parallelRecording = enabled; }
+
   private:
     GlobalResources *globalResources;
     VkCommandBuffer commandBuffer;
@@ -28,12 +47,54 @@ class Render {
     uint32_t currentFrame;
     VkSemaphore imageAvailableSemaphore;
     VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+    uint64_t completionValue = 0;
     Camera &camera;
     bool isFinished = false;
 
-    void recordRenderingCommands(Renderable &scene);
-    void recordRenderingCommands(RenderPass &pass);
+    // One draw call (a pass) or one run of indirect draws (an indirect group)
+    struct DrawItem {
+        Renderable *renderable;
+        uint32_t index;
+        bool depthPrepass;
+    };
+
+    std::vector<Renderable *> submitted;
+    bool sortDraws = true;
+    bool parallelRecording = true;
+    std::vector<DrawItem> drawItems;
+    std::vector<SortEntry> sortEntries;
+    std::vector<SortEntry> sortScratch;
+    // small per-frame numbers for the handles that go into sort keys, in the
+    // order they were first seen
+    std::unordered_map<PipelineID, uint32_t> pipelineOrdinals;
+    std::unordered_map<VkDescriptorSet, uint32_t> setOrdinals;
+    std::unordered_map<VkBuffer, uint32_t> meshOrdinals;
+
+    RenderStateTracker state;
+
+    // Updates attachments, uploads dynamic instances and records culling
+    // passes
+    void prepareRenderables();
+    void beginRendering(VkRenderingFlags flags = 0);
+
+    // Builds a sort key per draw of the submitted renderables
+    void collectDrawItems();
+    uint64_t makeSortKey(const DrawItem &item, float depth, VkBuffer mesh,
+                         uint32_t sequence);
+
+    // Number of secondary command buffers to record the draws into, zero
+    // records them directly into the primary one
+    size_t countRecordingChunks() const;
+    void recordChunks(size_t chunkCount);
+
+    void recordDrawItem(RenderStateTracker &tracker, VkCommandBuffer target,
+                        const DrawItem &item);
+    void recordRenderingCommands(RenderStateTracker &tracker,
+                                 VkCommandBuffer target, RenderPass &pass);
+    void recordIndirectCommands(RenderStateTracker &tracker,
+                                VkCommandBuffer target,
+                                Renderable &renderable,
+                                const IndirectDrawGroup &group);
 
     void submitCommandBuffer();
 };
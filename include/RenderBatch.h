@@ -1,10 +1,9 @@
 #pragma once
 
-#include "Instance.h"
+#include "InstanceArrays.h"
 #include "MeshManager.h"
-#include <vector>
 
 struct RenderBatch {
     MeshID meshId;
-    std::vector<Instance> instances;
+    InstanceArrays instances;
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <vulkan/vulkan.h>
+
+// Remembers what is bound to a command buffer and skips vkCmd* calls that
+// would bind the same state again. Only knows about commands issued through
+// it, reset() when recording starts on another command buffer.
+class RenderStateTracker {
+  public:
+    explicit RenderStateTracker(VkCommandBuffer commandBuffer)
+        : commandBuffer(commandBuffer) {}
+
+    void reset();
+
+    void bindPipeline(VkPipeline pipeline);
+    // Rebinds when the layout changes too, sets of an incompatible layout
+    // would be disturbed by the pipeline switch
+    void bindDescriptorSet(VkPipelineLayout layout, VkDescriptorSet set);
+    void bindVertexBuffer(uint32_t binding, VkBuffer buffer);
+    void bindIndexBuffer(VkBuffer buffer, VkIndexType indexType);
+    // Full-extent viewport and scissor, both dynamic state
+    void setViewportAndScissor(VkExtent2D extent);
+
+  private:
+    static constexpr uint32_t MAX_VERTEX_BINDINGS = 2;
+
+    VkCommandBuffer commandBuffer;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    std::array<VkBuffer, MAX_VERTEX_BINDINGS> vertexBuffers{};
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    VkExtent2D viewportExtent{0, 0};
+};
@@ -1,26 +1,143 @@
 #pragma once
 
+#include "Buffer.h"
+#include "DescriptorSet.h"
+#include "GlobalResources.h"
+#include "CpuCuller.h"
+#include "InstanceBuffer.h"
+#include "InstanceCuller.h"
 #include "Model.h"
 #include "PipelineSettings.h"
 #include "RenderPass.h"
 #include <cstring>
+#include <memory>
 #include <vector>
 
+struct RenderableOptions {
+    // Draw all passes from a buffer of indirect commands instead of recording
+    // a draw call per pass. Ignored when the device lacks
+    // drawIndirectFirstInstance.
+    bool indirect = true;
+    // Frustum cull instances in a compute pre-pass every frame. Only works
+    // together with indirect draws and needs shaders/cull.spv.
+    bool frustumCulling = false;
+    // Frustum cull on the CPU and skip passes without visible instances.
+    // Also used when frustumCulling is requested but indirect draws are
+    // unavailable.
+    bool cpuCulling = false;
+    // Keep the instances in host-visible buffers, one per frame in flight,
+    // so they can be changed with Renderable::updateInstances
+    bool dynamicInstances = false;
+    // Lay down depth in a pre-pass with a trivial fragment shader, then shade
+    // with an EQUAL depth test so every pixel is shaded once. Only used for
+    // opaque pipelines (no blending, depth writes on), needs
+    // shaders/depth.spv.
+    bool depthPrepass = false;
+};
+
+// Consecutive indirect commands that use the same vertex and index buffers
+struct IndirectDrawGroup {
+    VkBuffer vertexBuffer;
+    VkBuffer indexBuffer;
+    VkIndexType indexType;
+    uint32_t firstCommand;
+    uint32_t commandCount;
+};
+
 class Renderable {
   public:
     Renderable(GlobalResources *resources, Model &model,
-               PipelineSettings &settings);
+               PipelineSettings &settings,
+               const RenderableOptions &options = {});
 
     ~Renderable();
 
+    // The destructor hands the descriptor set back to the cache, a copy or
+    // moved-from object would release it a second time
+    Renderable(const Renderable &) = delete;
+    Renderable &operator=(const Renderable &) = delete;
+    Renderable(Renderable &&) = delete;
+    Renderable &operator=(Renderable &&) = delete;
+
     // TODO: potentially merging, for convenience - not everything can be
     // merged as a model, and having different renderables for different
     // materials is a bit crazy :3
 
     std::vector<RenderPass> &getRenderPasses() { return passes; }
 
+    PipelineID getPipelineId() const { return pipelineId; }
+
+    bool hasDepthPrepass() const { return depthPrepass; }
+    // Blended, has to be drawn after opaque geometry
+    bool isTranslucent() const { return translucent; }
+    PipelineID getDepthPipelineId() const { return depthPipelineId; }
+
+    // Instances of all passes, every pass owns a contiguous range. With
+    // culling only the visible ones of the given frame.
+    VkBuffer getInstanceBuffer(uint32_t frameIndex) const {
+        return culler ? culler->getInstanceBuffer(frameIndex)
+                      : instanceBuffer->getBuffer(frameIndex);
+    }
+
+    InstanceBuffer &getInstances() { return *instanceBuffer; }
+
+    // Needs dynamic instances. batchIndex refers to the batches of the Model
+    // the Renderable was created from, firstInstance is relative to the
+    // batch. The change shows up starting with the next Render.
+    void updateInstances(size_t batchIndex, uint32_t firstInstance,
+                         const std::vector<Instance> &instances);
+
+    VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const {
+        return descriptorSet->getSet(frameIndex);
+    }
+
+    bool usesIndirectDraws() const { return indirectBuffer != nullptr; }
+    VkBuffer getIndirectBuffer(uint32_t frameIndex) const {
+        return culler ? culler->getIndirectBuffer(frameIndex)
+                      : indirectBuffer->getBuffer();
+    }
+    const std::vector<IndirectDrawGroup> &getIndirectGroups() const {
+        return indirectGroups;
+    }
+
+    // nullptr unless frustum culling is enabled
+    InstanceCuller *getCuller() { return culler.get(); }
+    // nullptr unless the passes are culled on the CPU
+    CpuCuller *getCpuCuller() { return cpuCuller.get(); }
+
+    const std::vector<std::reference_wrapper<IAttachment>> &
+    getAttachments() const {
+        return attachments;
+    }
+
   private:
+    void createPipelines(const PipelineSettings &settings, bool depthPrepass,
+                         uint32_t maxFramesInFlight);
+    void createPasses(Model &model, bool dynamicInstances,
+                      uint32_t maxFramesInFlight);
+    void createDescriptorSets(uint32_t maxFramesInFlight);
+    void createIndirectBuffer(bool frustumCulling, uint32_t maxFramesInFlight);
+
     GlobalResources *resources;
+    // Pipelines are shared between renderables with the same layout, the
+    // attachment objects are per renderable
+    std::vector<std::reference_wrapper<IAttachment>> attachments;
+    PipelineID pipelineId;
+    bool depthPrepass = false;
+    bool translucent = false;
+    PipelineID depthPipelineId = 0;
 
     std::vector<RenderPass> passes;
+    // index of the pass created from each of the model's batches
+    std::vector<size_t> passOfBatch;
+    std::unique_ptr<InstanceBuffer> instanceBuffer;
+
+    std::unique_ptr<Buffer> indirectBuffer;
+    std::vector<IndirectDrawGroup> indirectGroups;
+    std::unique_ptr<InstanceCuller> culler;
+    std::unique_ptr<CpuCuller> cpuCuller;
+
+    // All passes share the pipeline and therefore the attachments
+    // owned by the global DescriptorSetCache
+    const DescriptorSet *descriptorSet = nullptr;
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Device.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+// Persistently mapped host-visible buffer that hands out staging space in a
+// ring. Every sub-allocation is tagged with the upload batch that uses it and
+// the space is reclaimed once that batch has completed, so steady-state
+// uploads don't touch the allocator at all.
+class StagingRing {
+  public:
+    StagingRing(Device *device, VkDeviceSize capacity);
+    ~StagingRing() = default;
+
+    StagingRing(const StagingRing &) = delete;
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    // Returns false when there is not enough free space right now; the caller
+    // has to wait for older batches to complete and retry
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, uint64_t batch,
+                  VkDeviceSize &offset, void *&mapped);
+
+    // Reclaims the space of every batch up to and including the given one
+    void release(uint64_t completedBatch);
+
+    VkBuffer getBuffer() const { return buffer->getBuffer(); }
+    VkDeviceSize getCapacity() const { return capacity; }
+
+  private:
+    struct Region {
+        uint64_t batch;
+        // ring position right after the region's last allocation
+        VkDeviceSize end;
+    };
+
+    std::unique_ptr<Buffer> buffer;
+    char *mapped = nullptr;
+    VkDeviceSize capacity;
+
+    VkDeviceSize head = 0;
+    VkDeviceSize tail = 0;
+    std::deque<Region> regions;
+};
@@ -3,12 +3,14 @@
 #include "AppWindow.h"
 #include "Device.h"
 #include "Image.h"
+#include "SwapChainSettings.h"
 #include <vector>
 #include <vulkan/vulkan.h>
 
 class SwapChain {
   public:
-    SwapChain(Device *device, AppWindow *appWindow);
+    SwapChain(Device *device, AppWindow *appWindow,
+              const SwapChainSettings &settings = {});
     ~SwapChain();
 
     SwapChain(const SwapChain &) = delete;
@@ -17,6 +19,9 @@ class SwapChain {
     VkSwapchainKHR getSwapChain() const { return swapChain; }
     VkFormat getImageFormat() const { return swapChainImageFormat; }
     VkExtent2D getExtent() const { return swapChainExtent; }
+    // The mode picked from the settings' preferences
+    VkPresentModeKHR getPresentMode() const { return presentMode; }
+    const SwapChainSettings &getSettings() const { return settings; }
     uint32_t getImageCount() const {
         return static_cast<uint32_t>(swapChainImages.size());
     }
@@ -29,6 +34,8 @@ class SwapChain {
     VkFormat findDepthFormat() const;
 
     void recreate();
+    // Recreates the swap chain with the new settings
+    void applySettings(const SwapChainSettings &settings);
     void cleanup();
 
     void transitionImageLayout(VkImageLayout fromLayout, VkImageLayout toLayout,
@@ -63,6 +70,7 @@ class SwapChain {
 
     Device *device;
     AppWindow *appWindow;
+    SwapChainSettings settings;
     VkExtent2D windowExtent;
 
     VkSwapchainKHR swapChain;
@@ -70,6 +78,7 @@ class SwapChain {
     std::vector<VkImageView> swapChainImageViews;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
     Image image;
     Image depthImage;
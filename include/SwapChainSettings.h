@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// How frames are handed to the display. Present modes are tried in order and
+// FIFO, the only one every surface supports, is the fallback when none of
+// them is available. The defaults match the engine's previous behavior.
+struct SwapChainSettings {
+    std::vector<VkPresentModeKHR> presentModes = {VK_PRESENT_MODE_MAILBOX_KHR};
+    // Clamped to the range the surface supports, so 1 requests the minimum.
+    // Zero picks one image more than the minimum.
+    uint32_t imageCount = 0;
+
+    // Vsynced with as few queued images as possible, for interactive use
+    static SwapChainSettings lowLatency() {
+        SwapChainSettings settings;
+        settings.presentModes = {VK_PRESENT_MODE_FIFO_KHR};
+        settings.imageCount = 1;
+        return settings;
+    }
+
+    // Uncapped frame rate, for benchmarks. Tears with IMMEDIATE, MAILBOX
+    // replaces queued images instead.
+    static SwapChainSettings uncapped() {
+        SwapChainSettings settings;
+        settings.presentModes = {VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                 VK_PRESENT_MODE_MAILBOX_KHR};
+        return settings;
+    }
+};
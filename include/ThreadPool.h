@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads executing submitted tasks in FIFO order.
+// High priority tasks run before any queued normal ones, so per-frame work
+// does not wait behind background jobs. Destroying the pool finishes the
+// queued tasks before joining.
+class ThreadPool {
+  public:
+    // Zero picks one thread per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    enum class Priority { Normal, High };
+
+    // The future also carries any exception thrown by the task
+    template <typename Task>
+    auto submit(Task &&task, Priority priority = Priority::Normal)
+        -> std::future<std::invoke_result_t<Task>> {
+        using Result = std::invoke_result_t<Task>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(
+            std::forward<Task>(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &queue = priority == Priority::High ? urgentTasks : tasks;
+            queue.emplace([packaged] { (*packaged)(); });
+        }
+        taskAvailable.notify_one();
+        return future;
+    }
+
+    size_t getThreadCount() const { return workers.size(); }
+
+  private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::queue<std::function<void()>> urgentTasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+};
@@ -17,6 +17,7 @@ template <typename T> class UniformAttachment : public IAttachment {
         VkDeviceSize bufferSize = sizeof(T);
         uniformBuffers.resize(maxFramesInFlight);
         uniformBuffersMapped.resize(maxFramesInFlight);
+        ubos.resize(maxFramesInFlight);
 
         for (size_t i = 0; i < maxFramesInFlight; i++) {
             uniformBuffers[i] = std::make_unique<Buffer>(
@@ -65,7 +66,7 @@ template <typename T> class UniformAttachment : public IAttachment {
   private:
     uint32_t bindingLocation;
     std::function<void(T &)> updator;
-    std::vector<T> ubos = std::vector<T>(3);
+    std::vector<T> ubos;
 
     // Uniform buffer resources
     std::vector<std::unique_ptr<Buffer>> uniformBuffers;
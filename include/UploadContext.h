@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Buffer.h"
+#include "CommandBuffer.h"
+#include "Device.h"
+#include "StagingRing.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class Image;
+
+// Monotonically increasing id of a submitted upload batch
+using UploadToken = uint64_t;
+
+struct StagingAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void *mapped = nullptr;
+};
+
+// Records many staging copies into one command buffer and submits them
+// together, so loading an asset costs one queue round-trip instead of one
+// blocking submit per buffer. Work recorded here becomes visible to every
+// command submitted to the graphics queue after the batch.
+//
+// When the device has a dedicated transfer queue the copies run there, and
+// ownership of the written ranges is handed over to the graphics queue family
+// by a small acquire submission on the graphics queue.
+class UploadContext {
+  public:
+    explicit UploadContext(Device *device);
+    ~UploadContext();
+
+    UploadContext(const UploadContext &) = delete;
+    UploadContext &operator=(const UploadContext &) = delete;
+
+    // Command buffer of the batch currently being recorded, for custom
+    // transfer commands. Might belong to the transfer queue.
+    VkCommandBuffer record();
+
+    // Graphics queue command buffer of the current batch. It executes after
+    // everything recorded through record() and the ownership transfers.
+    VkCommandBuffer recordGraphics();
+
+    // Host-visible memory that stays alive until the current batch completes.
+    // Comes from the staging ring, only requests larger than the whole ring
+    // get a dedicated buffer.
+    StagingAllocation allocateStaging(VkDeviceSize size,
+                                      VkDeviceSize alignment = 16);
+
+    void uploadToBuffer(Buffer &dstBuffer, const void *data, VkDeviceSize size,
+                        VkDeviceSize dstOffset = 0);
+
+    // Device-side copy, recorded on the graphics queue part of the batch
+    void copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer, VkDeviceSize size,
+                    VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+
+    // Transitions the whole image to TRANSFER_DST, copies the regions (whose
+    // bufferOffset is relative to the staging allocation) and leaves the image
+    // in SHADER_READ_ONLY_OPTIMAL
+    void copyToImage(const StagingAllocation &staging, Image &image,
+                     VkFormat format,
+                     std::vector<VkBufferImageCopy> regions);
+
+    // Submits everything recorded so far. Returns the token of the last
+    // submitted batch if there is nothing new to submit.
+    UploadToken submit();
+
+    bool isComplete(UploadToken token);
+
+    void wait(UploadToken token);
+
+    void waitAll();
+
+  private:
+    struct Batch {
+        UploadToken token = 0;
+        // only used with a dedicated transfer queue, otherwise everything is
+        // recorded into graphicsCommands
+        std::unique_ptr<CommandBuffer> transferCommands;
+        // records the acquire half of the ownership transfers
+        std::unique_ptr<CommandBuffer> acquireCommands;
+        std::unique_ptr<CommandBuffer> graphicsCommands;
+        VkSemaphore transferDone = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        // dedicated buffers for uploads that don't fit into the ring
+        std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+        std::vector<VkBufferMemoryBarrier> bufferReleases;
+        std::vector<VkImageMemoryBarrier> imageReleases;
+    };
+
+    void beginBatch();
+    void submitOwnershipTransfers();
+    void retireCompleted();
+    void recycle(std::unique_ptr<Batch> batch);
+
+    void releaseBuffer(Buffer &buffer, VkDeviceSize offset, VkDeviceSize size);
+    void releaseImage(Image &image);
+
+    std::unique_ptr<CommandBuffer> obtainCommandBuffer(bool transfer);
+    VkFence obtainFence();
+    VkSemaphore obtainSemaphore();
+
+    Device *device;
+    bool useTransferQueue;
+    std::unique_ptr<StagingRing> stagingRing;
+
+    std::unique_ptr<Batch> recording;
+    std::deque<std::unique_ptr<Batch>> inFlight;
+
+    std::vector<std::unique_ptr<CommandBuffer>> freeGraphicsCommandBuffers;
+    std::vector<std::unique_ptr<CommandBuffer>> freeTransferCommandBuffers;
+    std::vector<VkFence> freeFences;
+    std::vector<VkSemaphore> freeSemaphores;
+
+    UploadToken nextToken = 1;
+    UploadToken lastSubmitted = 0;
+    UploadToken lastCompleted = 0;
+};
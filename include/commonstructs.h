@@ -15,6 +15,8 @@
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // transfer-capable family without graphics support, if the device has one
+    std::optional<uint32_t> transferFamily;
 
     [[nodiscard]] bool isComplete() const {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -7,3 +7,5 @@ fi
 
 ${1} shader.vert -o vert.spv
 ${1} shader.frag -o frag.spv
+${1} cull.comp -o cull.spv
+${1} depth.frag -o depth.spv
@@ -0,0 +1,6 @@
+#version 450
+
+// Fragment stage of the depth pre-pass, only the depth written by the
+// rasterizer matters
+void main() {
+}
@@ -24,6 +24,10 @@ layout(location = 3) out vec3 normalVector;
 
 layout(location = 4) flat out ivec4 fragMaterial;
 
+// the depth pre-pass and the shading pass run this shader in different
+// pipelines, the EQUAL depth test needs bit-identical positions
+invariant gl_Position;
+
 void main() {
     vertexPos = inModel * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * ubo.view * vertexPos;
@@ -18,6 +18,10 @@ layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec4 vertexPos;
 layout(location = 3) out vec3 normalVector;
 
+// the depth pre-pass and the shading pass run this shader in different
+// pipelines, the EQUAL depth test needs bit-identical positions
+invariant gl_Position;
+
 void main() {
     vertexPos = instanceMatrix * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * ubo.view * vertexPos;
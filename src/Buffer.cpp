@@ -1,11 +1,12 @@
 #include "Buffer.h"
-#include "CommandBuffer.h"
 #include "Device.h"
+#include "UploadContext.h"
 #include <stdexcept>
 
 Buffer::Buffer(Device *device, VkDeviceSize size, VkBufferUsageFlags usage,
                VkMemoryPropertyFlags properties, VmaMemoryUsage memoryUsage,
-               VmaAllocationCreateFlagBits allocBits)
+               VmaAllocationCreateFlagBits allocBits,
+               bool sharedWithTransferQueue)
     : device(device) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -13,6 +14,15 @@ Buffer::Buffer(Device *device, VkDeviceSize size, VkBufferUsageFlags usage,
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    uint32_t queueFamilyIndices[] = {device->getGraphicsQueueFamily(),
+                                     device->getTransferQueueFamily()};
+    if (sharedWithTransferQueue && device->hasDedicatedTransferQueue()) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+        concurrent = true;
+    }
+
     if (vkCreateBuffer(*device->getDevice(), &bufferInfo, nullptr, &buffer) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create buffer!");
@@ -39,11 +49,11 @@ Buffer::Buffer(Device *device, VkDeviceSize size, VkBufferUsageFlags usage,
 
 Buffer::~Buffer() {
     if (buffer != VK_NULL_HANDLE) {
-        // vkDestroyBuffer(*device->getDevice(), buffer, nullptr);
         if (bufferHasBeenMapped) {
             unmap();
         }
-        device->freeAllocationMemoryOnDemand(&allocation);
+        // frames in flight might still read the buffer
+        device->freeAllocationMemoryDeferred(allocation);
     }
 }
 
@@ -71,12 +81,12 @@ void Buffer::recordCopyToImage(VkCommandBuffer cmdBuffer, VkImage image,
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
+// The synchronous helpers below go through the upload context and wait on its
+// fence only, instead of idling the whole graphics queue
 void Buffer::copyFrom(Buffer &srcBuffer, VkDeviceSize size) {
-    CommandBuffer cmd(device, device->getGraphicsCommandPool());
-    cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    srcBuffer.recordCopyTo(cmd.getCommandBuffer(), *this, size);
-    cmd.end();
-    cmd.submit(VK_NULL_HANDLE, true);
+    auto &uploads = device->getUploadContext();
+    srcBuffer.recordCopyTo(uploads.recordGraphics(), *this, size);
+    uploads.wait(uploads.submit());
 }
 
 void Buffer::map(void **data) {
@@ -93,23 +103,19 @@ void Buffer::unmap() {
 }
 
 void Buffer::copyToImage(VkImage image, uint32_t width, uint32_t height) {
-    CommandBuffer cmd(device, device->getGraphicsCommandPool());
-    cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    recordCopyToImage(cmd.getCommandBuffer(), image, width, height);
-    cmd.end();
-    cmd.submit(VK_NULL_HANDLE, true);
+    auto &uploads = device->getUploadContext();
+    recordCopyToImage(uploads.recordGraphics(), image, width, height);
+    uploads.wait(uploads.submit());
 }
 
 void Buffer::copyToImage(VkImage image,
                          const std::vector<VkBufferImageCopy> &regions) {
-    CommandBuffer cmd(device, device->getGraphicsCommandPool());
-    cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    auto &uploads = device->getUploadContext();
 
-    vkCmdCopyBufferToImage(cmd.getCommandBuffer(), buffer, image,
+    vkCmdCopyBufferToImage(uploads.recordGraphics(), buffer, image,
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                            static_cast<uint32_t>(regions.size()),
                            regions.data());
 
-    cmd.end();
-    cmd.submit(VK_NULL_HANDLE, true);
+    uploads.wait(uploads.submit());
 }
@@ -23,13 +23,14 @@ CommandPool::~CommandPool() {
 }
 
 std::vector<VkCommandBuffer>
-CommandPool::allocateCommandBuffers(uint32_t count) {
+CommandPool::allocateCommandBuffers(uint32_t count,
+                                    VkCommandBufferLevel level) {
     std::vector<VkCommandBuffer> commandBuffers(count);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.level = level;
     allocInfo.commandBufferCount = count;
 
     if (vkAllocateCommandBuffers(*device->getDevice(), &allocInfo,
@@ -39,3 +40,10 @@ CommandPool::allocateCommandBuffers(uint32_t count) {
 
     return commandBuffers;
 }
+
+void CommandPool::reset() {
+    if (vkResetCommandPool(*device->getDevice(), commandPool, 0) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to reset command pool!");
+    }
+}
@@ -0,0 +1,72 @@
+#include "ComputePipeline.h"
+#include "Pipeline.h"
+#include <stdexcept>
+
+ComputePipeline::ComputePipeline(
+    Device *device, const std::string &shaderPath,
+    const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+    uint32_t pushConstantSize, VkPipelineCache pipelineCache)
+    : device(device), descriptorLayout(*device->getDevice(), bindings) {
+    auto shaderCode = Pipeline::readFile(shaderPath);
+    VkShaderModule shaderModule =
+        Pipeline::createShaderModule(*device->getDevice(), shaderCode);
+
+    VkPipelineShaderStageCreateInfo shaderStageInfo{};
+    shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageInfo.module = shaderModule;
+    shaderStageInfo.pName = "main";
+
+    // Pipeline Layout
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    auto layout = descriptorLayout.getLayout();
+    pipelineLayoutInfo.pSetLayouts = &layout;
+    if (pushConstantSize > 0) {
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    }
+    if (vkCreatePipelineLayout(*device->getDevice(), &pipelineLayoutInfo,
+                               nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline layout!");
+    }
+
+    // Create Pipeline
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shaderStageInfo;
+    pipelineInfo.layout = pipelineLayout;
+    if (vkCreateComputePipelines(*device->getDevice(), pipelineCache, 1,
+                                 &pipelineInfo, nullptr,
+                                 &computePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+
+    vkDestroyShaderModule(*device->getDevice(), shaderModule, nullptr);
+}
+
+void ComputePipeline::cleanup() {
+    if (pipelineLayout == VK_NULL_HANDLE) {
+        return;
+    }
+    // recorded frames might still dispatch the pipeline
+    device->defer([device = device, pipeline = computePipeline,
+                   layout = pipelineLayout,
+                   setLayout = descriptorLayout]() mutable {
+        if (pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(*device->getDevice(), pipeline, nullptr);
+        }
+        if (layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(*device->getDevice(), layout, nullptr);
+        }
+        setLayout.cleanup();
+    });
+    computePipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+}
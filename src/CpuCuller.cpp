@@ -0,0 +1,112 @@
+#include "CpuCuller.h"
+#include <algorithm>
+
+void CpuCuller::addPass(const std::vector<BoundingSphere> &instanceSpheres) {
+    PassRange pass{};
+    pass.first = static_cast<uint32_t>(centerX.size());
+    pass.count = static_cast<uint32_t>(instanceSpheres.size());
+
+    for (const auto &sphere : instanceSpheres) {
+        centerX.push_back(sphere.center.x);
+        centerY.push_back(sphere.center.y);
+        centerZ.push_back(sphere.center.z);
+        radius.push_back(sphere.radius);
+    }
+
+    updatePassBounds(pass);
+    passes.push_back(pass);
+    visiblePasses.push_back(1);
+}
+
+void CpuCuller::updateSpheres(size_t passIndex, uint32_t firstInstance,
+                              const std::vector<BoundingSphere> &spheres) {
+    auto &pass = passes[passIndex];
+    for (size_t i = 0; i < spheres.size(); i++) {
+        size_t index = pass.first + firstInstance + i;
+        centerX[index] = spheres[i].center.x;
+        centerY[index] = spheres[i].center.y;
+        centerZ[index] = spheres[i].center.z;
+        radius[index] = spheres[i].radius;
+    }
+
+    // recomputed lazily, instances often move many times between culls
+    pass.boundsDirty = true;
+}
+
+void CpuCuller::cull(const Frustum &frustum) {
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (passes[i].boundsDirty) {
+            updatePassBounds(passes[i]);
+        }
+        visiblePasses[i] = anyVisible(passes[i], frustum) ? 1 : 0;
+    }
+}
+
+void CpuCuller::updatePassBounds(PassRange &pass) {
+    pass.boundsDirty = false;
+    pass.bounds = {};
+    if (pass.count == 0) {
+        return;
+    }
+
+    uint32_t end = pass.first + pass.count;
+
+    glm::vec3 min(centerX[pass.first], centerY[pass.first],
+                  centerZ[pass.first]);
+    glm::vec3 max = min;
+    for (uint32_t i = pass.first; i < end; i++) {
+        glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        min = glm::min(min, center - radius[i]);
+        max = glm::max(max, center + radius[i]);
+    }
+
+    pass.bounds.center = (min + max) * 0.5f;
+    for (uint32_t i = pass.first; i < end; i++) {
+        glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        pass.bounds.radius =
+            std::max(pass.bounds.radius,
+                     glm::length(center - pass.bounds.center) + radius[i]);
+    }
+}
+
+bool CpuCuller::anyVisible(const PassRange &pass,
+                           const Frustum &frustum) const {
+    if (pass.count == 0) {
+        return false;
+    }
+
+    // Test the whole pass first, most passes are either completely inside
+    // or completely outside
+    bool fullyInside = true;
+    for (const auto &plane : frustum.planes) {
+        float distance =
+            glm::dot(glm::vec3(plane), pass.bounds.center) + plane.w;
+        if (distance < -pass.bounds.radius) {
+            return false;
+        }
+        fullyInside = fullyInside && distance >= pass.bounds.radius;
+    }
+    if (fullyInside) {
+        return true;
+    }
+
+    const float *x = centerX.data() + pass.first;
+    const float *y = centerY.data() + pass.first;
+    const float *z = centerZ.data() + pass.first;
+    const float *r = radius.data() + pass.first;
+
+    // Branch-free so it vectorizes, a pass is rarely big enough for an early
+    // exit to pay off
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < pass.count; i++) {
+        bool inside = true;
+        for (const auto &plane : frustum.planes) {
+            inside &= plane.x * x[i] + plane.y * y[i] + plane.z * z[i] +
+                          plane.w >=
+                      -r[i];
+        }
+        visibleCount += inside;
+    }
+
+    return visibleCount > 0;
+}
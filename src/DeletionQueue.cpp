@@ -0,0 +1,32 @@
+#include "DeletionQueue.h"
+#include <cstdint>
+
+void DeletionQueue::push(uint64_t retireValue,
+                         std::function<void()> destroy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back({retireValue, std::move(destroy)});
+}
+
+void DeletionQueue::collect(uint64_t completedValue) {
+    Entry entry;
+    while (popRetired(completedValue, entry)) {
+        entry.destroy();
+    }
+}
+
+void DeletionQueue::flush() { collect(UINT64_MAX); }
+
+bool DeletionQueue::empty() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.empty();
+}
+
+bool DeletionQueue::popRetired(uint64_t completedValue, Entry &entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.empty() || entries.front().retireValue > completedValue) {
+        return false;
+    }
+    entry = std::move(entries.front());
+    entries.pop_front();
+    return true;
+}
@@ -0,0 +1,142 @@
+#include "DescriptorAllocator.h"
+#include "Device.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Descriptors of each type per set, a rough fit for the engine's layouts.
+// Running out of one of them just starts the next pool early.
+constexpr std::pair<VkDescriptorType, uint32_t> DESCRIPTORS_PER_SET[] = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+};
+
+} // namespace
+
+void DescriptorAllocator::init(Device *device) {
+    this->device = device;
+    poolsToken = std::make_shared<int>(0);
+}
+
+void DescriptorAllocator::cleanup() {
+    // sets from these pools might still be bound by frames in flight
+    if (!pools.empty()) {
+        device->defer([device = device, pools = std::move(pools)] {
+            for (auto pool : pools) {
+                vkDestroyDescriptorPool(*device->getDevice(), pool, nullptr);
+            }
+        });
+    }
+    pools.clear();
+    liveSets.clear();
+    poolsToken.reset();
+    nextPoolSize = INITIAL_SETS_PER_POOL;
+}
+
+VkDescriptorPool DescriptorAllocator::allocate(
+    const std::vector<VkDescriptorSetLayout> &layouts,
+    const std::unordered_map<VkDescriptorType, uint32_t> &descriptorCounts,
+    VkDescriptorSet *sets) {
+    if (!device) {
+        throw std::runtime_error(
+            "DescriptorAllocator not initialized with device!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (!pools.empty()) {
+        allocInfo.descriptorPool = pools.back();
+        auto result =
+            vkAllocateDescriptorSets(*device->getDevice(), &allocInfo, sets);
+        if (result == VK_SUCCESS) {
+            liveSets[pools.back()] += allocInfo.descriptorSetCount;
+            return pools.back();
+        }
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+            result != VK_ERROR_FRAGMENTED_POOL) {
+            throw std::runtime_error("failed to allocate descriptor sets!");
+        }
+    }
+
+    // the current pool is full. Older ones are not revisited, they are
+    // destroyed once their last set is freed.
+    uint32_t poolSize = std::max(nextPoolSize, allocInfo.descriptorSetCount);
+    std::unordered_map<VkDescriptorType, uint32_t> required;
+    for (auto [type, count] : descriptorCounts) {
+        required[type] = count * allocInfo.descriptorSetCount;
+    }
+    pools.push_back(createPool(poolSize, required));
+    nextPoolSize = std::min(nextPoolSize * 2, MAX_SETS_PER_POOL);
+
+    allocInfo.descriptorPool = pools.back();
+    if (vkAllocateDescriptorSets(*device->getDevice(), &allocInfo, sets) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+    liveSets[pools.back()] += allocInfo.descriptorSetCount;
+    return pools.back();
+}
+
+void DescriptorAllocator::free(VkDescriptorPool pool,
+                               std::vector<VkDescriptorSet> sets) {
+    if (sets.empty()) {
+        return;
+    }
+    device->defer([this, token = std::weak_ptr<int>(poolsToken), pool,
+                   sets = std::move(sets)] {
+        // after cleanup() the sets went away with their pool
+        if (!token.expired()) {
+            freeNow(pool, sets);
+        }
+    });
+}
+
+void DescriptorAllocator::freeNow(VkDescriptorPool pool,
+                                  const std::vector<VkDescriptorSet> &sets) {
+    vkFreeDescriptorSets(*device->getDevice(), pool,
+                         static_cast<uint32_t>(sets.size()), sets.data());
+
+    auto &live = liveSets[pool];
+    live -= static_cast<uint32_t>(sets.size());
+    // the current pool is kept for the next allocations
+    if (live > 0 || pool == pools.back()) {
+        return;
+    }
+    liveSets.erase(pool);
+    pools.erase(std::find(pools.begin(), pools.end(), pool));
+    vkDestroyDescriptorPool(*device->getDevice(), pool, nullptr);
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(
+    uint32_t maxSets,
+    const std::unordered_map<VkDescriptorType, uint32_t> &required) {
+    auto counts = required;
+    for (auto [type, count] : DESCRIPTORS_PER_SET) {
+        counts[type] = std::max(counts[type], count * maxSets);
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (auto [type, count] : counts) {
+        poolSizes.push_back({type, count});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    // sets of unloaded content are given back individually
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = maxSets;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(*device->getDevice(), &poolInfo, nullptr,
+                               &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    return pool;
+}
@@ -13,6 +13,17 @@ DescriptorLayout::DescriptorLayout(
         bindings.push_back(binding);
     }
 
+    createLayout(bindings);
+}
+
+DescriptorLayout::DescriptorLayout(
+    VkDevice device, const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+    : device(device) {
+    createLayout(bindings);
+}
+
+void DescriptorLayout::createLayout(
+    const std::vector<VkDescriptorSetLayoutBinding> &bindings) {
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -24,9 +24,31 @@ void DescriptorSet::init(VkDevice device, const DescriptorPool &pool,
     }
 }
 
+void DescriptorSet::init(
+    VkDevice device, DescriptorAllocator &allocator,
+    const DescriptorLayout &layout, uint32_t count,
+    const std::unordered_map<VkDescriptorType, uint32_t> &descriptorCounts) {
+    this->device = device;
+    descriptorSets.resize(count);
+
+    std::vector<VkDescriptorSetLayout> layouts(count, layout.getLayout());
+    pool =
+        allocator.allocate(layouts, descriptorCounts, descriptorSets.data());
+    this->allocator = &allocator;
+}
+
+void DescriptorSet::release() {
+    if (allocator) {
+        allocator->free(pool, std::move(descriptorSets));
+        allocator = nullptr;
+    }
+    descriptorSets.clear();
+}
+
 void DescriptorSet::updateBufferInfo(size_t bufferIndex, uint32_t binding,
                                      VkBuffer buffer, VkDeviceSize offset,
-                                     VkDeviceSize range) {
+                                     VkDeviceSize range,
+                                     VkDescriptorType type) {
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = buffer;
     bufferInfo.offset = offset;
@@ -37,7 +59,7 @@ void DescriptorSet::updateBufferInfo(size_t bufferIndex, uint32_t binding,
     descriptorWrite.dstSet = descriptorSets[bufferIndex];
     descriptorWrite.dstBinding = binding;
     descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorType = type;
     descriptorWrite.descriptorCount = 1;
     descriptorWrite.pBufferInfo = &bufferInfo;
 
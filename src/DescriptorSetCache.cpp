@@ -0,0 +1,72 @@
+#include "DescriptorSetCache.h"
+#include "Hash.h"
+
+void DescriptorSetCache::init(Device *device) {
+    this->device = device;
+    allocator.init(device);
+}
+
+void DescriptorSetCache::cleanup() {
+    keyOfSet.clear();
+    sets.clear();
+    allocator.cleanup();
+}
+
+const DescriptorSet &DescriptorSetCache::get(
+    uint64_t layoutKey, const DescriptorLayout &layout,
+    const std::vector<std::reference_wrapper<IAttachment>> &attachments,
+    uint32_t count) {
+    Key key{layoutKey, count, {}};
+    for (auto &attachment : attachments) {
+        key.attachments.push_back(&attachment.get());
+    }
+
+    auto &entry = sets[key];
+    entry.users++;
+    if (entry.set) {
+        return *entry.set;
+    }
+
+    std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
+    for (auto &attachment : attachments) {
+        descriptorCounts[attachment.get().getType()] +=
+            attachment.get().getDescriptorCount();
+    }
+
+    auto &set = entry.set;
+    set = std::make_unique<DescriptorSet>();
+    set->init(*device->getDevice(), allocator, layout, count,
+              descriptorCounts);
+    for (auto &attachment : attachments) {
+        attachment.get().updateDescriptorSet(count, *set);
+    }
+    keyOfSet.emplace(set.get(), std::move(key));
+    return *set;
+}
+
+void DescriptorSetCache::release(const DescriptorSet &set) {
+    auto keyIt = keyOfSet.find(&set);
+    if (keyIt == keyOfSet.end()) {
+        return;
+    }
+    auto it = sets.find(keyIt->second);
+    if (--it->second.users > 0) {
+        return;
+    }
+
+    // the key is gone right away, so new attachments at the same addresses
+    // get fresh sets. The Vulkan sets are freed once the frames retire.
+    it->second.set->release();
+    keyOfSet.erase(keyIt);
+    sets.erase(it);
+}
+
+size_t DescriptorSetCache::KeyHash::operator()(const Key &key) const {
+    Hasher hasher;
+    hasher.add(key.layoutKey);
+    hasher.add(key.count);
+    for (auto attachment : key.attachments) {
+        hasher.add(reinterpret_cast<uintptr_t>(attachment));
+    }
+    return hasher.get();
+}
@@ -5,27 +5,49 @@
 #include <variant>
 #include <vector>
 
+#include "UploadContext.h"
 #include "ValidationLayersInfo.h"
 
 const std::vector<const char *> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME};
 
-void Device::init(const AppWindow *appWindow, const AppInstance *appInstance) {
+void Device::init(const AppWindow *appWindow, const AppInstance *appInstance,
+                  uint32_t maxFramesInFlight) {
+    if (maxFramesInFlight == 0) {
+        throw std::runtime_error("At least one frame has to be in flight!");
+    }
     this->appWindow = appWindow;
     this->appInstance = appInstance;
+    this->maxFramesInFlight = maxFramesInFlight;
 
     pickPhysicalDevice();
     createLogicalDevice();
     createAllocator();
 
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
     graphicsCommandPool =
-        new CommandPool(this, indices.graphicsFamily.value(),
+        new CommandPool(this, queueFamilies.graphicsFamily.value(),
                         VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+    if (queueFamilies.transferFamily.has_value()) {
+        transferCommandPool =
+            new CommandPool(this, queueFamilies.transferFamily.value(),
+                            VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    }
+
+    timeline.init(this);
+    uploadContext = new UploadContext(this);
 }
 
 Device::~Device() {
+    delete uploadContext;
+
+    // everything still queued is released together with the device
+    vkDeviceWaitIdle(device);
+    deletionQueue.flush();
+
+    delete transferCommandPool;
     delete graphicsCommandPool;
+    timeline.cleanup();
 
     std::for_each(allocations.begin(), allocations.end(),
                   [this](auto &allocationToCleanUp) {
@@ -38,6 +60,15 @@ Device::~Device() {
 
 const VkDevice *Device::getDevice() const { return &device; }
 
+void Device::defer(std::function<void()> destroy) {
+    // the frame being recorded signals the next value once submitted
+    deletionQueue.push(timeline.getLastSubmitted() + 1, std::move(destroy));
+}
+
+void Device::collectDeferred() {
+    deletionQueue.collect(timeline.getCompleted());
+}
+
 const VkPhysicalDevice *Device::getPhysicalDevice() const {
     return &physicalDevice;
 }
@@ -77,10 +108,14 @@ void Device::pickPhysicalDevice() {
 
 void Device::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    queueFamilies = indices;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
                                               indices.presentFamily.value()};
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -97,8 +132,23 @@ void Device::createLogicalDevice() {
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
     dynamicRenderingFeature.dynamicRendering = VK_TRUE;
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeature{};
+    timelineFeature.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeature.timelineSemaphore = VK_TRUE;
+    dynamicRenderingFeature.pNext = &timelineFeature;
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // optional, indirect rendering falls back to per-draw commands without
+    // them
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance =
+        supportedFeatures.drawIndirectFirstInstance;
+    enabledFeatures = deviceFeatures;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -129,6 +179,11 @@ void Device::createLogicalDevice() {
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    if (indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(device, indices.transferFamily.value(), 0,
+                         &transferQueue);
+    }
 }
 
 void Device::createAllocator() {
@@ -159,8 +214,18 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+    // frame pacing and deferred deletion run on a timeline semaphore
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeature{};
+    timelineFeature.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeature;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
     return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-           supportedFeatures.samplerAnisotropy;
+           supportedFeatures.samplerAnisotropy &&
+           timelineFeature.timelineSemaphore;
 }
 
 bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -195,20 +260,28 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
 
     int i = 0;
     for (const auto &queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
+        if (!indices.isComplete()) {
+            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                indices.graphicsFamily = i;
+            }
+
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(
+                device, i, appWindow->getTargetSurface(), &presentSupport);
+
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(
-            device, i, appWindow->getTargetSurface(), &presentSupport);
-
-        if (presentSupport) {
-            indices.presentFamily = i;
-        }
-
-        if (indices.isComplete()) {
-            break;
+        // A family that can transfer but not draw maps to the copy engine;
+        // prefer a pure transfer family over an async compute one
+        bool canTransfer = queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT;
+        bool canDraw = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        bool canCompute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        if (canTransfer && !canDraw &&
+            (!indices.transferFamily.has_value() || !canCompute)) {
+            indices.transferFamily = i;
         }
 
         i++;
@@ -293,6 +366,14 @@ Device::submitToAvailablePresentQueue(const VkPresentInfoKHR *info) const {
     return vkQueuePresentKHR(graphicsQueue, info);
 }
 
+VkResult Device::submitToTransferQueue(const VkSubmitInfo *info,
+                                       VkFence submitFence) const {
+    if (transferQueue == VK_NULL_HANDLE) {
+        return vkQueueSubmit(graphicsQueue, 1, info, submitFence);
+    }
+    return vkQueueSubmit(transferQueue, 1, info, submitFence);
+}
+
 VkResult
 Device::allocateBufferMemory(const VkBufferCreateInfo *bufCreateInfo,
                              const VmaAllocationCreateInfo *allocCreateInfo,
@@ -381,6 +462,13 @@ VkResult Device::freeAllocationMemoryOnDemand(
     return VK_SUCCESS;
 }
 
+void Device::freeAllocationMemoryDeferred(
+    DeviceMemoryAllocationHandle allocation) {
+    defer([this, allocation]() mutable {
+        freeAllocationMemoryOnDemand(&allocation);
+    });
+}
+
 VkImageView Device::createImageView(VkImage image, VkFormat format,
                                     VkImageAspectFlags aspectFlags) {
     VkImageViewCreateInfo viewInfo{};
@@ -1,24 +1,30 @@
 #include "Engine.h"
 
 #include "SwapChain.h"
+#include "UploadContext.h"
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
-Engine::Engine() : mainCamera(glm::vec3(0.0f, 0.0f, 3.0f)) { initVulkan(); }
+Engine::Engine(const EngineSettings &settings)
+    : settings(settings), mainCamera(glm::vec3(0.0f, 0.0f, 3.0f)) {
+    initVulkan();
+}
 
 bool Engine::running() const {
     return isRunning && !glfwWindowShouldClose(appWindow.getWindow());
 }
 
 Render Engine::startRender() {
-    vkWaitForFences(*appDevice.getDevice(), 1, &inFlightFences[currentFrame],
-                    VK_TRUE, UINT64_MAX);
+    // Flush uploads recorded since the last frame so they execute before it
+    appDevice.getUploadContext().submit();
+
+    // Wait until the last frame recorded into this slot has retired, which
+    // keeps at most framesInFlight frames queued on the GPU
+    appDevice.getTimeline().wait(frameCompletionValues[currentFrame]);
+    // objects released since then may have been used by the retired frames
+    appDevice.collectDeferred();
 
     uint32_t imageIndex = globalResources.getSwapChain().acquireNextImage(
         imageAvailableSemaphores[currentFrame]);
 
-    vkResetFences(*appDevice.getDevice(), 1, &inFlightFences[currentFrame]);
-
     commandBuffers[currentFrame]->reset();
     commandBuffers[currentFrame]->begin(
         VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
@@ -40,12 +46,12 @@ Render Engine::startRender() {
     return Render(&globalResources,
                   commandBuffers[currentFrame]->getCommandBuffer(), imageIndex,
                   currentFrame, imageAvailableSemaphores[currentFrame],
-                  renderFinishedSemaphores[currentFrame],
-                  inFlightFences[currentFrame], mainCamera);
+                  renderFinishedSemaphores[currentFrame], mainCamera);
 }
 
 void Engine::finishRender(Render &render) {
     bool needsRecreation = render.finish();
+    frameCompletionValues[currentFrame] = render.getCompletionValue();
 
     // TODO: fix semaphores staying signaled when window is resized
     if (needsRecreation || framebufferResized) {
@@ -53,7 +59,12 @@ void Engine::finishRender(Render &render) {
         globalResources.getSwapChain().handleResizing();
     }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % settings.framesInFlight;
+}
+
+void Engine::setSwapChainSettings(const SwapChainSettings &swapChainSettings) {
+    settings.swapChain = swapChainSettings;
+    globalResources.getSwapChain().applySettings(swapChainSettings);
 }
 
 void Engine::processEvents() { glfwPollEvents(); }
@@ -103,22 +114,21 @@ void Engine::initVulkan() {
     appWindow.init(&appInstance, framebufferResizeCallback);
     appInstance.setAppWindow(appWindow.getWindow());
 
-    appDevice.init(&appWindow, &appInstance);
+    appDevice.init(&appWindow, &appInstance, settings.framesInFlight);
     appInstance.setAppDevice(appDevice.getDevice());
 
-    globalResources.init(&appDevice, &appWindow);
+    globalResources.init(&appDevice, &appWindow, settings.swapChain);
 
     createCommandBuffers();
     createSyncObjects();
 }
 
 void Engine::initializeEngineTeardown() {
-    vkWaitForFences(*appDevice.getDevice(), MAX_FRAMES_IN_FLIGHT,
-                    inFlightFences.data(), VK_TRUE, UINT64_MAX);
+    auto &timeline = appDevice.getTimeline();
+    timeline.wait(timeline.getLastSubmitted());
     vkDeviceWaitIdle(*appDevice.getDevice());
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        vkDestroyFence(*appDevice.getDevice(), inFlightFences[i], nullptr);
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); ++i) {
         vkDestroySemaphore(*appDevice.getDevice(), renderFinishedSemaphores[i],
                            nullptr);
         vkDestroySemaphore(*appDevice.getDevice(), imageAvailableSemaphores[i],
@@ -137,32 +147,27 @@ void Engine::initializeEngineTeardown() {
 }
 
 void Engine::createCommandBuffers() {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    commandBuffers.resize(settings.framesInFlight);
+    for (size_t i = 0; i < settings.framesInFlight; i++) {
         commandBuffers[i] = std::make_unique<CommandBuffer>(
             &appDevice, appDevice.getGraphicsCommandPool());
     }
 }
 
 void Engine::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(settings.framesInFlight);
+    renderFinishedSemaphores.resize(settings.framesInFlight);
+    // zero is the timeline's initial value, so unused slots never wait
+    frameCompletionValues.assign(settings.framesInFlight, 0);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < settings.framesInFlight; i++) {
         if (vkCreateSemaphore(*appDevice.getDevice(), &semaphoreInfo, nullptr,
                               &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(*appDevice.getDevice(), &semaphoreInfo, nullptr,
-                              &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(*appDevice.getDevice(), &fenceInfo, nullptr,
-                          &inFlightFences[i]) != VK_SUCCESS) {
+                              &renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error(
                 "Failed to create synchronization objects for a frame!");
         }
@@ -173,6 +178,7 @@ TextureManager Engine::createTextureManager() {
     return TextureManager(&appDevice);
 }
 
-Renderable Engine::shaded(Model &model, PipelineSettings &settings) {
-    return Renderable(&globalResources, model, settings);
+Renderable Engine::shaded(Model &model, PipelineSettings &settings,
+                          const RenderableOptions &options) {
+    return Renderable(&globalResources, model, settings, options);
 }
@@ -1,18 +1,43 @@
 #include "GlobalResources.h"
+#include "InstanceCuller.h"
+#include <algorithm>
+#include <thread>
 
 GlobalResources::~GlobalResources() {
+    parallelRecorder.cleanup();
     meshManager.cleanup();
+    descriptorSets.cleanup();
     pipelineManager.cleanup();
+    if (cullingPipeline) {
+        cullingPipeline->cleanup();
+    }
     swapChain->cleanup();
 }
 
-void GlobalResources::init(Device *device, AppWindow *appWindow) {
+void GlobalResources::init(Device *device, AppWindow *appWindow,
+                           const SwapChainSettings &swapChainSettings) {
     this->device = device;
 
     SwapChainSupportDetails swapChainSupport =
         device->querySwapChainSupportCurrent();
-    swapChain = std::make_unique<SwapChain>(device, appWindow);
+    swapChain =
+        std::make_unique<SwapChain>(device, appWindow, swapChainSettings);
 
-    pipelineManager.init(device);
+    // the main thread keeps a hardware thread of its own
+    auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    threads = std::make_unique<ThreadPool>(hardwareThreads - 1);
+
+    pipelineManager.init(device, *threads);
     meshManager.init(device);
+    descriptorSets.init(device);
+    parallelRecorder.init(device, *threads, device->getMaxFramesInFlight());
+}
+
+ComputePipeline &GlobalResources::getCullingPipeline() {
+    if (!cullingPipeline) {
+        cullingPipeline = std::make_unique<ComputePipeline>(
+            device, SHADER_DIR "cull.spv", InstanceCuller::layoutBindings(),
+            sizeof(CullPushConstants), pipelineManager.getPipelineCache());
+    }
+    return *cullingPipeline;
 }
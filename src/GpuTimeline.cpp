@@ -0,0 +1,61 @@
+#include "GpuTimeline.h"
+#include "Device.h"
+#include <algorithm>
+#include <stdexcept>
+
+void GpuTimeline::init(Device *device) {
+    this->device = device;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(*device->getDevice(), &semaphoreInfo, nullptr,
+                          &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timeline semaphore!");
+    }
+}
+
+void GpuTimeline::cleanup() {
+    if (semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(*device->getDevice(), semaphore, nullptr);
+        semaphore = VK_NULL_HANDLE;
+    }
+}
+
+uint64_t GpuTimeline::getCompleted() {
+    if (lastCompleted < lastSubmitted) {
+        if (vkGetSemaphoreCounterValue(*device->getDevice(), semaphore,
+                                       &lastCompleted) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to query timeline semaphore!");
+        }
+    }
+    return lastCompleted;
+}
+
+bool GpuTimeline::isComplete(uint64_t value) {
+    return value <= getCompleted();
+}
+
+void GpuTimeline::wait(uint64_t value) {
+    if (isComplete(value)) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(*device->getDevice(), &waitInfo, UINT64_MAX) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to wait for timeline semaphore!");
+    }
+    lastCompleted = std::max(lastCompleted, value);
+}
@@ -1,15 +1,16 @@
 #include "Image.h"
-#include "Buffer.h"
-#include "CommandBuffer.h"
 #include "Device.h"
+#include "UploadContext.h"
 #include "stb_image.h"
 
 Image::~Image() { cleanUp(); }
 
 void Image::cleanUp() {
     if (image != VK_NULL_HANDLE) {
-        device.freeAllocationMemoryOnDemand(&imageAllocationHandle);
-        vkDestroyImageView(*device.getDevice(), imageView, nullptr);
+        device.defer([&device = device, view = imageView] {
+            vkDestroyImageView(*device.getDevice(), view, nullptr);
+        });
+        device.freeAllocationMemoryDeferred(imageAllocationHandle);
         image = VK_NULL_HANDLE;
     }
 }
@@ -84,40 +85,37 @@ VkImageView Image::createImageView(VkFormat format,
 
 void Image::transitionImageLayout(VkFormat format, VkImageLayout oldLayout,
                                   VkImageLayout newLayout) {
-    CommandBuffer cmd(&device, device.getGraphicsCommandPool());
-    cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    recordTransitionLayout(cmd.getCommandBuffer(), format, oldLayout,
+    auto &uploads = device.getUploadContext();
+    recordTransitionLayout(uploads.recordGraphics(), format, oldLayout,
                            newLayout);
-    cmd.end();
-    cmd.submit(VK_NULL_HANDLE, true);
+    uploads.wait(uploads.submit());
 }
 
 void Image::createTextureImageFromMemory(const unsigned char *pixels, int width,
                                          int height, int channels) {
     VkDeviceSize imageSize = width * height * channels;
 
-    Buffer stagingBuffer(
-        &device, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        VMA_MEMORY_USAGE_AUTO,
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    void *data;
-    stagingBuffer.map(&data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    stagingBuffer.unmap();
+    auto &uploads = device.getUploadContext();
+    auto staging = uploads.allocateStaging(imageSize);
+    memcpy(staging.mapped, pixels, static_cast<size_t>(imageSize));
 
     createImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    stagingBuffer.copyToImage(image, width, height);
-    transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {static_cast<uint32_t>(width),
+                          static_cast<uint32_t>(height), 1};
+
+    uploads.copyToImage(staging, *this, VK_FORMAT_R8G8B8A8_SRGB, {region});
 }
 
 void Image::createTextureImageView() {
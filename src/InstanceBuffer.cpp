@@ -0,0 +1,118 @@
+#include "InstanceBuffer.h"
+#include "UploadContext.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// A frame whose renderable is not drawn never flushes, past this many ranges
+// its list is merged, or collapsed into one range if merging does not help
+static constexpr size_t maxDirtyRanges = 64;
+
+// Sorts the ranges and joins overlapping and adjacent ones
+static void mergeRanges(std::vector<InstanceBuffer::DirtyRange> &ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const InstanceBuffer::DirtyRange &a,
+                 const InstanceBuffer::DirtyRange &b) {
+                  return a.begin < b.begin;
+              });
+
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].begin <= ranges[merged].end) {
+            ranges[merged].end = std::max(ranges[merged].end, ranges[i].end);
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    ranges.resize(merged + 1);
+}
+
+InstanceBuffer::InstanceBuffer(Device *device,
+                               const std::vector<InstanceData> &instances,
+                               bool dynamic, uint32_t maxFramesInFlight)
+    : instanceCount(static_cast<uint32_t>(instances.size())),
+      dynamic(dynamic) {
+    VkDeviceSize bufferSize = sizeof(InstanceData) * instances.size();
+    VkBufferUsageFlags usage =
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    if (!dynamic) {
+        buffers.push_back(std::make_unique<Buffer>(
+            device, std::max<VkDeviceSize>(bufferSize, 1),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE));
+
+        device->getUploadContext().uploadToBuffer(
+            *buffers[0], instances.data(), bufferSize);
+        return;
+    }
+
+    this->instances = instances;
+    dirtyRanges.resize(maxFramesInFlight);
+
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        buffers.push_back(std::make_unique<Buffer>(
+            device, std::max<VkDeviceSize>(bufferSize, 1), usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+
+        void *data;
+        buffers[i]->map(&data);
+        mappedBuffers.push_back(static_cast<InstanceData *>(data));
+
+        if (bufferSize > 0) {
+            memcpy(data, instances.data(), static_cast<size_t>(bufferSize));
+        }
+    }
+}
+
+void InstanceBuffer::update(uint32_t firstInstance, const InstanceData *data,
+                            uint32_t count) {
+    if (!dynamic) {
+        throw std::runtime_error("Cannot update a static instance buffer!");
+    }
+    if (firstInstance + count > instanceCount) {
+        throw std::runtime_error("Instance update out of range!");
+    }
+    if (count == 0) {
+        return;
+    }
+
+    std::copy(data, data + count, instances.begin() + firstInstance);
+
+    // every frame's buffer has to catch up on its own
+    for (auto &ranges : dirtyRanges) {
+        ranges.push_back({firstInstance, firstInstance + count});
+        if (ranges.size() <= maxDirtyRanges) {
+            continue;
+        }
+        mergeRanges(ranges);
+        if (ranges.size() > maxDirtyRanges / 2) {
+            ranges = {{ranges.front().begin, ranges.back().end}};
+        }
+    }
+}
+
+void InstanceBuffer::flush(uint32_t frameIndex) {
+    if (!dynamic) {
+        return;
+    }
+
+    auto &ranges = dirtyRanges[frameIndex];
+    if (ranges.empty()) {
+        return;
+    }
+
+    // overlapping updates are only written once
+    mergeRanges(ranges);
+    for (auto &range : ranges) {
+        memcpy(mappedBuffers[frameIndex] + range.begin,
+               instances.data() + range.begin,
+               sizeof(InstanceData) * (range.end - range.begin));
+    }
+
+    ranges.clear();
+}
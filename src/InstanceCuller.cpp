@@ -0,0 +1,178 @@
+#include "InstanceCuller.h"
+#include "ComputePipeline.h"
+#include "GlobalResources.h"
+#include "InstanceData.h"
+#include "UploadContext.h"
+#include <algorithm>
+#include <unordered_map>
+
+static constexpr uint32_t workgroupSize = 64;
+
+InstanceCuller::InstanceCuller(
+    GlobalResources *resources, const std::vector<VkBuffer> &instanceBuffers,
+    const std::vector<VkDrawIndexedIndirectCommand> &commands,
+    const std::vector<uint32_t> &drawOfInstance,
+    const std::vector<glm::vec4> &drawBounds, uint32_t maxFramesInFlight)
+    : resources(resources),
+      instanceCount(static_cast<uint32_t>(drawOfInstance.size())),
+      commandsSize(sizeof(VkDrawIndexedIndirectCommand) * commands.size()) {
+    auto device = resources->getDevice();
+    auto &uploads = device->getUploadContext();
+
+    VkDeviceSize drawOfInstanceSize = sizeof(uint32_t) * drawOfInstance.size();
+    drawOfInstanceBuffer = createDeviceBuffer(
+        drawOfInstanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    uploads.uploadToBuffer(*drawOfInstanceBuffer, drawOfInstance.data(),
+                           drawOfInstanceSize);
+
+    VkDeviceSize drawBoundsSize = sizeof(glm::vec4) * drawBounds.size();
+    drawBoundsBuffer =
+        createDeviceBuffer(drawBoundsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    uploads.uploadToBuffer(*drawBoundsBuffer, drawBounds.data(),
+                           drawBoundsSize);
+
+    auto resetCommands = commands;
+    for (auto &command : resetCommands) {
+        command.instanceCount = 0;
+    }
+    resetCommandsBuffer =
+        createDeviceBuffer(commandsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    uploads.uploadToBuffer(*resetCommandsBuffer, resetCommands.data(),
+                           commandsSize);
+
+    VkDeviceSize instancesSize = sizeof(InstanceData) * instanceCount;
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        indirectBuffers.push_back(createDeviceBuffer(
+            commandsSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
+        visibleInstanceBuffers.push_back(createDeviceBuffer(
+            instancesSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT));
+    }
+
+    auto &pipeline = resources->getCullingPipeline();
+
+    std::unordered_map<VkDescriptorType, uint32_t> descriptorTypeCounts;
+    descriptorTypeCounts[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER] =
+        static_cast<uint32_t>(layoutBindings().size());
+    descriptorSet.init(*device->getDevice(),
+                       resources->getDescriptorSets().getAllocator(),
+                       pipeline.getDescriptorLayout(), maxFramesInFlight,
+                       descriptorTypeCounts);
+
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        descriptorSet.updateBufferInfo(i, 0, instanceBuffers[i], 0,
+                                       VK_WHOLE_SIZE,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        descriptorSet.updateBufferInfo(i, 1, drawOfInstanceBuffer->getBuffer(),
+                                       0, VK_WHOLE_SIZE,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        descriptorSet.updateBufferInfo(i, 2, drawBoundsBuffer->getBuffer(), 0,
+                                       VK_WHOLE_SIZE,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        descriptorSet.updateBufferInfo(i, 3, indirectBuffers[i]->getBuffer(),
+                                       0, VK_WHOLE_SIZE,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        descriptorSet.updateBufferInfo(
+            i, 4, visibleInstanceBuffers[i]->getBuffer(), 0, VK_WHOLE_SIZE,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+}
+
+InstanceCuller::~InstanceCuller() { descriptorSet.release(); }
+
+std::vector<VkDescriptorSetLayoutBinding> InstanceCuller::layoutBindings() {
+    std::vector<VkDescriptorSetLayoutBinding> bindings(5);
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    return bindings;
+}
+
+void InstanceCuller::record(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                            const Frustum &frustum) {
+    if (instanceCount == 0) {
+        return;
+    }
+
+    // Start from zero visible instances per draw
+    VkBufferMemoryBarrier resetBarrier{};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    resetBarrier.buffer = indirectBuffers[frameIndex]->getBuffer();
+    resetBarrier.offset = 0;
+    resetBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1,
+                         &resetBarrier, 0, nullptr);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = commandsSize;
+    vkCmdCopyBuffer(commandBuffer, resetCommandsBuffer->getBuffer(),
+                    indirectBuffers[frameIndex]->getBuffer(), 1, &copyRegion);
+
+    VkBufferMemoryBarrier countBarrier = resetBarrier;
+    countBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    countBarrier.dstAccessMask =
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    // The previous use of this frame's instance buffer has to be done too
+    VkBufferMemoryBarrier instanceBarrier = resetBarrier;
+    instanceBarrier.srcAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    instanceBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    instanceBarrier.buffer = visibleInstanceBuffers[frameIndex]->getBuffer();
+
+    VkBufferMemoryBarrier computeBarriers[] = {countBarrier, instanceBarrier};
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 2,
+                         computeBarriers, 0, nullptr);
+
+    auto &pipeline = resources->getCullingPipeline();
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                      pipeline.getPipeline());
+
+    auto currentDescriptorSet = descriptorSet.getSet(frameIndex);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline.getLayout(), 0, 1, &currentDescriptorSet,
+                            0, nullptr);
+
+    CullPushConstants pushConstants{};
+    std::copy(frustum.planes.begin(), frustum.planes.end(),
+              pushConstants.planes);
+    pushConstants.instanceCount = instanceCount;
+    vkCmdPushConstants(commandBuffer, pipeline.getLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants),
+                       &pushConstants);
+
+    vkCmdDispatch(commandBuffer,
+                  (instanceCount + workgroupSize - 1) / workgroupSize, 1, 1);
+
+    // Make the results visible to the draws
+    VkBufferMemoryBarrier drawBarriers[] = {countBarrier, instanceBarrier};
+    drawBarriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    drawBarriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarriers[1].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                         0, 0, nullptr, 2, drawBarriers, 0, nullptr);
+}
+
+std::unique_ptr<Buffer>
+InstanceCuller::createDeviceBuffer(VkDeviceSize size,
+                                   VkBufferUsageFlags usage) {
+    return std::make_unique<Buffer>(
+        resources->getDevice(), std::max<VkDeviceSize>(size, 4),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+}
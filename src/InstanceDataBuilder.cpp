@@ -1,21 +1,205 @@
 #include "InstanceDataBuilder.h"
+#include <algorithm>
+#include <future>
+#include <thread>
 
-std::vector<InstanceData>
-buildInstanceData(const std::vector<Instance> &instances) {
-    std::vector<InstanceData> instanceData;
-    instanceData.reserve(instances.size());
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+// Below this many instances per thread spawning threads costs more than the
+// work itself
+constexpr size_t MIN_INSTANCES_PER_THREAD = 16384;
+
+// Calls work(first, count) on disjoint chunks of [0, count) in parallel
+template <typename Work>
+void parallelFor(size_t count, ThreadPool *pool, const Work &work) {
+    // the calling thread takes one chunk
+    size_t hardwareThreads =
+        pool ? pool->getThreadCount() + 1
+             : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t threadCount = std::min(
+        hardwareThreads,
+        (count + MIN_INSTANCES_PER_THREAD - 1) / MIN_INSTANCES_PER_THREAD);
+
+    if (threadCount <= 1) {
+        work(0, count);
+        return;
+    }
+
+    // keep chunks a multiple of 4 so only the last one has a SIMD tail
+    size_t chunkSize = ((count + threadCount - 1) / threadCount + 3) & ~3;
+
+    if (pool) {
+        std::vector<std::future<void>> chunks;
+        for (size_t first = chunkSize; first < count; first += chunkSize) {
+            size_t chunk = std::min(chunkSize, count - first);
+            chunks.push_back(
+                pool->submit([&work, first, chunk] { work(first, chunk); }));
+        }
+        work(0, std::min(chunkSize, count));
+        // the chunks reference the output, wait for all before rethrowing
+        for (auto &chunk : chunks) {
+            chunk.wait();
+        }
+        for (auto &chunk : chunks) {
+            chunk.get();
+        }
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    size_t first = chunkSize;
+    for (; first < count; first += chunkSize) {
+        threads.emplace_back(work, first, std::min(chunkSize, count - first));
+    }
+    work(0, std::min(chunkSize, count));
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+// translate * toMat4(rotation) * scale without building the three matrices:
+// the columns of the rotation matrix are scaled and the translation becomes
+// the last column
+void composeTransform(const glm::vec3 &position, const glm::quat &rotation,
+                      const glm::vec3 &scale, glm::mat4 &transform) {
+    float xx = rotation.x * rotation.x, yy = rotation.y * rotation.y,
+          zz = rotation.z * rotation.z;
+    float xy = rotation.x * rotation.y, xz = rotation.x * rotation.z,
+          yz = rotation.y * rotation.z;
+    float wx = rotation.w * rotation.x, wy = rotation.w * rotation.y,
+          wz = rotation.w * rotation.z;
+
+    transform[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz),
+                             2.0f * (xz - wy), 0.0f) *
+                   scale.x;
+    transform[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz),
+                             2.0f * (yz + wx), 0.0f) *
+                   scale.y;
+    transform[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx),
+                             1.0f - 2.0f * (xx + yy), 0.0f) *
+                   scale.z;
+    transform[3] = glm::vec4(position, 1.0f);
+}
+
+void buildScalar(const InstanceArrays &instances, size_t index,
+                 InstanceData &data) {
+    composeTransform({instances.positionX[index], instances.positionY[index],
+                      instances.positionZ[index]},
+                     glm::quat(instances.rotationW[index],
+                               instances.rotationX[index],
+                               instances.rotationY[index],
+                               instances.rotationZ[index]),
+                     {instances.scaleX[index], instances.scaleY[index],
+                      instances.scaleZ[index]},
+                     data.transform);
+    data.textureIndices = instances.textureIds[index];
+}
 
-    for (const auto &instance : instances) {
-        InstanceData data;
+#ifdef __SSE2__
+// Composes the transforms of four instances at once, one instance per lane.
+// The results are per matrix element, so every column gets transposed back
+// into one vec4 per instance before storing.
+void buildSimd(const InstanceArrays &instances, size_t first,
+               InstanceData *output) {
+    __m128 x = _mm_loadu_ps(&instances.rotationX[first]);
+    __m128 y = _mm_loadu_ps(&instances.rotationY[first]);
+    __m128 z = _mm_loadu_ps(&instances.rotationZ[first]);
+    __m128 w = _mm_loadu_ps(&instances.rotationW[first]);
 
-        // Get transform matrix
-        data.transform = instance.getTransformMatrix();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 zero = _mm_setzero_ps();
 
-        // Copy texture indices directly from material
-        data.textureIndices = instance.material.textureIds;
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y),
+           zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z),
+           yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y),
+           wz = _mm_mul_ps(w, z);
 
-        instanceData.push_back(data);
+    __m128 sx = _mm_loadu_ps(&instances.scaleX[first]);
+    __m128 sy = _mm_loadu_ps(&instances.scaleY[first]);
+    __m128 sz = _mm_loadu_ps(&instances.scaleZ[first]);
+
+    auto twice = [&](__m128 value) { return _mm_mul_ps(two, value); };
+    auto oneMinusTwice = [&](__m128 a, __m128 b) {
+        return _mm_sub_ps(one, twice(_mm_add_ps(a, b)));
+    };
+
+    __m128 columns[4][4] = {
+        {_mm_mul_ps(oneMinusTwice(yy, zz), sx),
+         _mm_mul_ps(twice(_mm_add_ps(xy, wz)), sx),
+         _mm_mul_ps(twice(_mm_sub_ps(xz, wy)), sx), zero},
+        {_mm_mul_ps(twice(_mm_sub_ps(xy, wz)), sy),
+         _mm_mul_ps(oneMinusTwice(xx, zz), sy),
+         _mm_mul_ps(twice(_mm_add_ps(yz, wx)), sy), zero},
+        {_mm_mul_ps(twice(_mm_add_ps(xz, wy)), sz),
+         _mm_mul_ps(twice(_mm_sub_ps(yz, wx)), sz),
+         _mm_mul_ps(oneMinusTwice(xx, yy), sz), zero},
+        {_mm_loadu_ps(&instances.positionX[first]),
+         _mm_loadu_ps(&instances.positionY[first]),
+         _mm_loadu_ps(&instances.positionZ[first]), one},
+    };
+
+    for (int column = 0; column < 4; column++) {
+        __m128 *rows = columns[column];
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        for (int lane = 0; lane < 4; lane++) {
+            _mm_storeu_ps(&output[lane].transform[column][0], rows[lane]);
+        }
+    }
+
+    for (int lane = 0; lane < 4; lane++) {
+        output[lane].textureIndices = instances.textureIds[first + lane];
     }
+}
+#endif
+
+} // namespace
+
+std::vector<InstanceData>
+buildInstanceData(const std::vector<Instance> &instances,
+                  ThreadPool *threads) {
+    std::vector<InstanceData> instanceData(instances.size());
+
+    parallelFor(instances.size(), threads, [&](size_t first, size_t count) {
+        for (size_t i = first; i < first + count; i++) {
+            const auto &instance = instances[i];
+            composeTransform(instance.position, instance.rotation,
+                             instance.scale, instanceData[i].transform);
+            instanceData[i].textureIndices = instance.material.textureIds;
+        }
+    });
 
     return instanceData;
 }
+
+std::vector<InstanceData> buildInstanceData(const InstanceArrays &instances,
+                                            ThreadPool *threads) {
+    std::vector<InstanceData> instanceData(instances.size());
+
+    parallelFor(instances.size(), threads, [&](size_t first, size_t count) {
+        buildInstanceData(instances, first, count, instanceData.data() + first);
+    });
+
+    return instanceData;
+}
+
+void buildInstanceData(const InstanceArrays &instances, size_t first,
+                       size_t count, InstanceData *output) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= count; i += 4) {
+        buildSimd(instances, first + i, output + i);
+    }
+#endif
+    for (; i < count; i++) {
+        buildScalar(instances, first + i, output[i]);
+    }
+}
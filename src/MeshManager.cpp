@@ -1,78 +1,201 @@
 #include "MeshManager.h"
 #include "Buffer.h"
 #include "Device.h"
-#include <cstring>
+#include "UploadContext.h"
+#include <algorithm>
+#include <limits>
+
+// Sizes of the shared buffers, meshes that don't fit get a bigger block
+static constexpr VkDeviceSize vertexBlockSize = 32 * 1024 * 1024;
+static constexpr VkDeviceSize indexBlockSize = 16 * 1024 * 1024;
+
+void MeshManager::init(Device *device, MeshStorage storage) {
+    this->device = device;
+    this->storage = storage;
+    blocksToken = std::make_shared<int>(0);
+}
 
-void MeshManager::init(Device *device) { this->device = device; }
+void MeshManager::cleanup() {
+    meshes.clear();
+    vertexBlocks.clear();
+    indexBlocks.clear();
+    blocksToken.reset();
+}
 
-void MeshManager::cleanup() { meshes.clear(); }
+static VkDeviceSize indexSize(VkIndexType indexType) {
+    return indexType == VK_INDEX_TYPE_UINT32 ? sizeof(uint32_t)
+                                             : sizeof(uint16_t);
+}
 
 MeshID MeshManager::registerMesh(const std::vector<Vertex> &vertices,
                                  const std::vector<uint16_t> &indices) {
+    return registerMesh(vertices, indices.data(),
+                        static_cast<uint32_t>(indices.size()),
+                        VK_INDEX_TYPE_UINT16);
+}
+
+MeshID MeshManager::registerMesh(const std::vector<Vertex> &vertices,
+                                 const std::vector<uint32_t> &indices) {
+    auto maxIndex = std::max_element(indices.begin(), indices.end());
+    if (maxIndex == indices.end() ||
+        *maxIndex <= std::numeric_limits<uint16_t>::max()) {
+        std::vector<uint16_t> narrowIndices(indices.begin(), indices.end());
+        return registerMesh(vertices, narrowIndices);
+    }
+
+    return registerMesh(vertices, indices.data(),
+                        static_cast<uint32_t>(indices.size()),
+                        VK_INDEX_TYPE_UINT32);
+}
+
+MeshID MeshManager::registerMesh(const std::vector<Vertex> &vertices,
+                                 const void *indexData, uint32_t indexCount,
+                                 VkIndexType indexType) {
     auto mesh = std::make_unique<Mesh>();
+    auto &uploads = device->getUploadContext();
 
-    // Create vertex buffer
     VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
+    VkDeviceSize indexBufferSize = indexSize(indexType) * indexCount;
+
+    if (storage == MeshStorage::Shared) {
+        placeShared(*mesh, vertexBufferSize, indexBufferSize,
+                    indexSize(indexType));
+    } else {
+        placeDedicated(*mesh, vertexBufferSize, indexBufferSize);
+    }
+
+    // Record the copies into the pending upload batch - they get submitted
+    // together with the rest of the asset
+    auto &vertexTarget = storage == MeshStorage::Shared
+                             ? *vertexBlocks[mesh->vertexBlock].buffer
+                             : *mesh->ownedVertexBuffer;
+    uploads.uploadToBuffer(vertexTarget, vertices.data(), vertexBufferSize,
+                           mesh->vertexOffset * sizeof(Vertex));
+
+    auto &indexTarget = storage == MeshStorage::Shared
+                            ? *indexBlocks[mesh->indexBlock].buffer
+                            : *mesh->ownedIndexBuffer;
+    uploads.uploadToBuffer(indexTarget, indexData, indexBufferSize,
+                           mesh->firstIndex * indexSize(indexType));
+
+    mesh->indexCount = indexCount;
+    mesh->indexType = indexType;
+    mesh->box = computeBoundingBox(vertices);
+    mesh->bounds = computeBoundingSphere(vertices, mesh->box);
 
-    // Create staging buffer for vertices
-    Buffer stagingBuffer(
-        device, vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        VMA_MEMORY_USAGE_AUTO,
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    // Copy vertex data to staging buffer
-    void *data;
-    stagingBuffer.map(&data);
-    memcpy(data, vertices.data(), vertexBufferSize);
-    stagingBuffer.unmap();
-
-    // Create device local vertex buffer
-    mesh->vertexBuffer = std::make_unique<Buffer>(
-        device, vertexBufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-
-    // Copy from staging buffer to device local buffer
-    mesh->vertexBuffer->copyFrom(stagingBuffer, vertexBufferSize);
+    // Store mesh and return ID
+    MeshID id = nextMeshId++;
+    meshes[id] = std::move(mesh);
+    return id;
+}
 
-    // Create index buffer
-    VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
+void MeshManager::unregisterMesh(MeshID id) {
+    auto it = meshes.find(id);
+    if (it == meshes.end()) {
+        return;
+    }
+
+    auto &mesh = *it->second;
+    if (storage == MeshStorage::Shared) {
+        // frames in flight may still read the ranges, a new mesh must not
+        // overwrite them before those retire
+        device->defer([this, token = std::weak_ptr<int>(blocksToken),
+                       vertexBlock = mesh.vertexBlock,
+                       vertexOffset = mesh.vertexOffset * sizeof(Vertex),
+                       vertexBytes = mesh.vertexRangeSize,
+                       indexBlock = mesh.indexBlock,
+                       indexOffset =
+                           mesh.firstIndex * indexSize(mesh.indexType),
+                       indexBytes = mesh.indexRangeSize] {
+            if (token.expired()) {
+                return;
+            }
+            vertexBlocks[vertexBlock].allocator.free(vertexOffset,
+                                                     vertexBytes);
+            indexBlocks[indexBlock].allocator.free(indexOffset, indexBytes);
+        });
+    }
+
+    meshes.erase(it);
+}
 
-    // Create staging buffer for indices
-    Buffer indexStagingBuffer(
-        device, indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        VMA_MEMORY_USAGE_AUTO,
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+const Mesh *MeshManager::getMesh(MeshID id) const {
+    auto it = meshes.find(id);
+    return it != meshes.end() ? it->second.get() : nullptr;
+}
 
-    // Copy index data to staging buffer
-    indexStagingBuffer.map(&data);
-    memcpy(data, indices.data(), indexBufferSize);
-    indexStagingBuffer.unmap();
+void MeshManager::placeDedicated(Mesh &mesh, VkDeviceSize vertexBytes,
+                                 VkDeviceSize indexBytes) {
+    mesh.ownedVertexBuffer = std::make_unique<Buffer>(
+        device, vertexBytes,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
 
-    // Create device local index buffer
-    mesh->indexBuffer = std::make_unique<Buffer>(
-        device, indexBufferSize,
+    mesh.ownedIndexBuffer = std::make_unique<Buffer>(
+        device, indexBytes,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
 
-    // Copy from staging buffer to device local buffer
-    mesh->indexBuffer->copyFrom(indexStagingBuffer, indexBufferSize);
-
-    mesh->indexCount = static_cast<uint32_t>(indices.size());
+    mesh.vertexBuffer = mesh.ownedVertexBuffer->getBuffer();
+    mesh.indexBuffer = mesh.ownedIndexBuffer->getBuffer();
+}
 
-    // Store mesh and return ID
-    MeshID id = nextMeshId++;
-    meshes[id] = std::move(mesh);
-    return id;
+void MeshManager::placeShared(Mesh &mesh, VkDeviceSize vertexBytes,
+                              VkDeviceSize indexBytes,
+                              VkDeviceSize indexStride) {
+    // empty ranges can't be allocated, reserve at least one element
+    vertexBytes = std::max<VkDeviceSize>(vertexBytes, sizeof(Vertex));
+    indexBytes = std::max(indexBytes, indexStride);
+
+    VkDeviceSize vertexOffset;
+    // aligning to the vertex size keeps the offset expressible in vertices
+    mesh.vertexBlock = allocateFromBlocks(
+        vertexBlocks, vertexBlockSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        vertexBytes, sizeof(Vertex), vertexOffset);
+    mesh.vertexBuffer = vertexBlocks[mesh.vertexBlock].buffer->getBuffer();
+    mesh.vertexOffset = static_cast<int32_t>(vertexOffset / sizeof(Vertex));
+    mesh.vertexRangeSize = vertexBytes;
+
+    VkDeviceSize indexOffset;
+    mesh.indexBlock = allocateFromBlocks(
+        indexBlocks, indexBlockSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        indexBytes, indexStride, indexOffset);
+    mesh.indexBuffer = indexBlocks[mesh.indexBlock].buffer->getBuffer();
+    mesh.firstIndex = static_cast<uint32_t>(indexOffset / indexStride);
+    mesh.indexRangeSize = indexBytes;
 }
 
-const Mesh *MeshManager::getMesh(MeshID id) const {
-    auto it = meshes.find(id);
-    return it != meshes.end() ? it->second.get() : nullptr;
+size_t MeshManager::allocateFromBlocks(std::vector<Block> &blocks,
+                                       VkDeviceSize blockSize,
+                                       VkBufferUsageFlags usage,
+                                       VkDeviceSize size,
+                                       VkDeviceSize alignment,
+                                       VkDeviceSize &offset) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+        uint64_t blockOffset;
+        if (blocks[i].allocator.allocate(size, alignment, blockOffset)) {
+            offset = blockOffset;
+            return i;
+        }
+    }
+
+    // Meshes from many uploads live in the same buffer, so it's shared with
+    // the transfer queue instead of transferring ownership per range
+    Block block;
+    VkDeviceSize capacity = std::max(blockSize, size);
+    block.buffer = std::make_unique<Buffer>(
+        device, capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        VMA_ALLOCATION_CREATE_STRATEGY_MIN_TIME_BIT, true);
+    block.allocator = OffsetAllocator(capacity);
+
+    uint64_t blockOffset;
+    block.allocator.allocate(size, alignment, blockOffset);
+    offset = blockOffset;
+
+    blocks.push_back(std::move(block));
+    return blocks.size() - 1;
 }
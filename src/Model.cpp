@@ -1,62 +1,63 @@
 #include "Model.h"
-#include <algorithm>
 
 void Model::addBatch(RenderBatch &&batch) {
-    batches.push_back(std::move(batch));
+    auto [existing, inserted] =
+        batchOfMesh.try_emplace(batch.meshId, batches.size());
+    if (inserted) {
+        batches.push_back(std::move(batch));
+    } else {
+        batches[existing->second].instances.append(batch.instances);
+    }
+}
+
+void Model::reserve(size_t batchCount) {
+    batches.reserve(batchCount);
+    batchOfMesh.reserve(batchCount);
 }
 
 Model Model::merge(Model &other) const {
-    Model result = *this;
-    for (const auto &batch : other.getBatches()) {
-        // First, try to find an existing batch with the same mesh ID
-        auto existingBatch =
-            std::find_if(result.batches.begin(), result.batches.end(),
-                         [&batch](const RenderBatch &b) {
-                             return b.meshId == batch.meshId;
-                         });
-        if (existingBatch != result.batches.end()) {
-            // If we found an existing batch, append the instances to it
-            existingBatch->instances.insert(existingBatch->instances.end(),
-                                            batch.instances.begin(),
-                                            batch.instances.end());
-            continue;
+    Model result;
+    result.reserve(batches.size() + other.batches.size());
+    result.mergeFrom(*this);
+    result.mergeFrom(other);
+    return result;
+}
+
+void Model::mergeFrom(const Model &other) {
+    for (const auto &batch : other.batches) {
+        auto existing = batchOfMesh.find(batch.meshId);
+        if (existing != batchOfMesh.end()) {
+            batches[existing->second].instances.append(batch.instances);
+        } else {
+            batchOfMesh.emplace(batch.meshId, batches.size());
+            batches.push_back(batch);
         }
-        // If we didn't find an existing batch, create a new one
-        else
-            result.addBatch(RenderBatch{batch.meshId, batch.instances});
     }
-    return result;
+}
+
+void Model::mergeFrom(Model &&other) {
+    for (auto &batch : other.batches) {
+        addBatch(std::move(batch));
+    }
+    other.batches.clear();
+    other.batchOfMesh.clear();
 }
 
 void Model::scale(float factor) {
     for (auto &batch : batches) {
-        for (auto &instance : batch.instances) {
-            instance.position *= factor;
-            instance.scale *= factor;
-        }
+        batch.instances.scale(factor);
     }
 }
 
 void Model::translate(const glm::vec3 &offset) {
     for (auto &batch : batches) {
-        for (auto &instance : batch.instances) {
-            instance.position += offset;
-        }
+        batch.instances.translate(offset);
     }
 }
 
 void Model::scatter(const std::vector<glm::vec3> &offsets) {
     // Replace the instances with offsets * instances copies
-    std::vector<RenderBatch> newBatches;
-    for (const auto &batch : batches) {
-        std::vector<Instance> newInstances;
-        for (const auto &instance : batch.instances) {
-            for (const auto &offset : offsets) {
-                newInstances.push_back(instance);
-                newInstances.back().position += offset;
-            }
-        }
-        newBatches.push_back(RenderBatch{batch.meshId, newInstances});
+    for (auto &batch : batches) {
+        batch.instances.scatter(offsets);
     }
-    batches = newBatches;
 }
@@ -1,5 +1,6 @@
 #include "ModelLoader.h"
 #include "TextureManager.h"
+#include "UploadContext.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -119,6 +120,14 @@ ModelLoader::processPrimitive(const tinygltf::Primitive &primitive,
     const tinygltf::Buffer &indexBuffer = model.buffers[indexView.buffer];
 
     switch (indexAccessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+        const uint8_t *indices = reinterpret_cast<const uint8_t *>(
+            &indexBuffer.data[indexView.byteOffset + indexAccessor.byteOffset]);
+        for (size_t i = 0; i < indexAccessor.count; i++) {
+            result.indices.push_back(indices[i]);
+        }
+        break;
+    }
     case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
         const uint16_t *indices = reinterpret_cast<const uint16_t *>(
             &indexBuffer.data[indexView.byteOffset + indexAccessor.byteOffset]);
@@ -324,6 +333,9 @@ Model ModelLoader::loadFromGLTF(const std::string &filename,
     createRenderBatches(materialPrimitives, gltfModel, resources, model,
                         textureManager);
 
+    // All mesh uploads of the model go to the GPU in a single submission
+    resources.getDevice()->getUploadContext().submit();
+
     return model;
 }
 
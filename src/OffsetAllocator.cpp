@@ -0,0 +1,66 @@
+#include "OffsetAllocator.h"
+#include <iterator>
+
+OffsetAllocator::OffsetAllocator(uint64_t capacity)
+    : capacity(capacity), freeSpace(capacity) {
+    if (capacity > 0) {
+        freeRanges[0] = capacity;
+    }
+}
+
+bool OffsetAllocator::allocate(uint64_t size, uint64_t alignment,
+                               uint64_t &offset) {
+    if (size == 0 || size > freeSpace) {
+        return false;
+    }
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        uint64_t rangeStart = it->first;
+        uint64_t rangeEnd = rangeStart + it->second;
+        uint64_t alignedStart =
+            (rangeStart + alignment - 1) / alignment * alignment;
+
+        if (alignedStart + size > rangeEnd) {
+            continue;
+        }
+
+        freeRanges.erase(it);
+
+        // give back the padding in front and whatever is left behind
+        if (alignedStart > rangeStart) {
+            freeRanges[rangeStart] = alignedStart - rangeStart;
+        }
+        if (alignedStart + size < rangeEnd) {
+            freeRanges[alignedStart + size] = rangeEnd - alignedStart - size;
+        }
+
+        freeSpace -= size;
+        offset = alignedStart;
+        return true;
+    }
+
+    return false;
+}
+
+void OffsetAllocator::free(uint64_t offset, uint64_t size) {
+    freeSpace += size;
+
+    auto next = freeRanges.lower_bound(offset);
+
+    // merge with the following range
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+
+    // merge with the preceding range
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+
+    freeRanges[offset] = size;
+}
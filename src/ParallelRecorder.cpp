@@ -0,0 +1,66 @@
+#include "ParallelRecorder.h"
+#include <stdexcept>
+
+void ParallelRecorder::init(Device *device, ThreadPool &threads,
+                            uint32_t maxFramesInFlight) {
+    this->device = device;
+    this->threads = &threads;
+    chunkCount = threads.getThreadCount();
+
+    pools.resize(maxFramesInFlight);
+    commandBuffers.resize(maxFramesInFlight);
+    for (uint32_t frame = 0; frame < maxFramesInFlight; frame++) {
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            auto pool = std::make_unique<CommandPool>(
+                device, device->getGraphicsQueueFamily(),
+                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+            commandBuffers[frame].push_back(pool->allocateCommandBuffers(
+                1, VK_COMMAND_BUFFER_LEVEL_SECONDARY)[0]);
+            pools[frame].push_back(std::move(pool));
+        }
+    }
+}
+
+void ParallelRecorder::cleanup() {
+    threads = nullptr;
+    // destroying the pools frees their command buffers
+    commandBuffers.clear();
+    pools.clear();
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex) {
+    for (auto &pool : pools[frameIndex]) {
+        pool->reset();
+    }
+}
+
+VkCommandBuffer ParallelRecorder::beginChunk(uint32_t frameIndex,
+                                             size_t chunk,
+                                             VkFormat colorFormat,
+                                             VkFormat depthFormat) {
+    VkCommandBuffer commandBuffer = commandBuffers[frameIndex][chunk];
+
+    VkCommandBufferInheritanceRenderingInfo renderingInfo{};
+    renderingInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat = depthFormat;
+    renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = &renderingInfo;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "Failed to begin recording secondary command buffer!");
+    }
+    return commandBuffer;
+}
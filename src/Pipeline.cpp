@@ -12,14 +12,18 @@
 
 Pipeline::Pipeline(Device *device, DescriptorLayout descriptorLayout,
                    VkFormat colorFormat, VkFormat depthFormat,
-                   uint32_t maxFramesInFlight, PipelineSettings &settings)
-    : device(device), descriptorLayout(std::move(descriptorLayout)),
-      attachments(settings.getAttachments()) {
-    auto vertShaderCode = readFile(settings.getVertexShaderPath());
-    auto fragShaderCode = readFile(settings.getFragmentShaderPath());
-
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+                   uint32_t maxFramesInFlight,
+                   const PipelineSettings &settings,
+                   const std::vector<char> &vertexShaderCode,
+                   const std::vector<char> &fragmentShaderCode,
+                   VkPipelineCache pipelineCache)
+    : device(device), descriptorLayout(std::move(descriptorLayout)) {
+    const auto &state = settings.getState();
+
+    VkShaderModule vertShaderModule =
+        createShaderModule(*device->getDevice(), vertexShaderCode);
+    VkShaderModule fragShaderModule =
+        createShaderModule(*device->getDevice(), fragmentShaderCode);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType =
@@ -87,7 +91,7 @@ Pipeline::Pipeline(Device *device, DescriptorLayout descriptorLayout,
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.cullMode = state.cullMode;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -102,18 +106,16 @@ Pipeline::Pipeline(Device *device, DescriptorLayout descriptorLayout,
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType =
         VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthTestEnable = state.depthTestEnable;
+    depthStencil.depthWriteEnable = state.depthWriteEnable;
+    depthStencil.depthCompareOp = state.depthCompareOp;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
 
     // Color Blending
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask =
-        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.colorWriteMask = state.colorWriteMask;
+    colorBlendAttachment.blendEnable = state.blendEnable;
     colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
     colorBlendAttachment.dstColorBlendFactor =
         VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -173,7 +175,7 @@ Pipeline::Pipeline(Device *device, DescriptorLayout descriptorLayout,
     pipelineInfo.layout = pipelineLayout;
     pipelineInfo.renderPass = VK_NULL_HANDLE;
     pipelineInfo.subpass = 0;
-    if (vkCreateGraphicsPipelines(*device->getDevice(), VK_NULL_HANDLE, 1,
+    if (vkCreateGraphicsPipelines(*device->getDevice(), pipelineCache, 1,
                                   &pipelineInfo, nullptr,
                                   &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
@@ -184,29 +186,37 @@ Pipeline::Pipeline(Device *device, DescriptorLayout descriptorLayout,
 }
 
 void Pipeline::cleanup() {
-    if (graphicsPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(*device->getDevice(), graphicsPipeline, nullptr);
-        graphicsPipeline = VK_NULL_HANDLE;
-    }
-    if (pipelineLayout != VK_NULL_HANDLE) {
-        vkDestroyPipelineLayout(*device->getDevice(), pipelineLayout, nullptr);
-        pipelineLayout = VK_NULL_HANDLE;
-    }
-    if (auto setLayout = descriptorLayout;
-        setLayout.getLayout() != VK_NULL_HANDLE) {
-        setLayout.cleanup();
+    if (pipelineLayout == VK_NULL_HANDLE) {
+        return;
     }
+    // recorded frames might still use the pipeline
+    device->defer([device = device, pipeline = graphicsPipeline,
+                   layout = pipelineLayout,
+                   setLayout = descriptorLayout]() mutable {
+        if (pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(*device->getDevice(), pipeline, nullptr);
+        }
+        if (layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(*device->getDevice(), layout, nullptr);
+        }
+        if (setLayout.getLayout() != VK_NULL_HANDLE) {
+            setLayout.cleanup();
+        }
+    });
+    graphicsPipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
 }
 
-VkShaderModule Pipeline::createShaderModule(const std::vector<char> &code) {
+VkShaderModule Pipeline::createShaderModule(VkDevice device,
+                                            const std::vector<char> &code) {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.codeSize = code.size();
     createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
 
     VkShaderModule shaderModule;
-    if (vkCreateShaderModule(*device->getDevice(), &createInfo, nullptr,
-                             &shaderModule) != VK_SUCCESS) {
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) !=
+        VK_SUCCESS) {
         throw std::runtime_error("failed to create shader module!");
     }
 
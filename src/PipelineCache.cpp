@@ -0,0 +1,139 @@
+#include "PipelineCache.h"
+#include "Hash.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t CACHE_FILE_MAGIC = 0x43504b56; // "VKPC"
+constexpr uint32_t CACHE_FILE_VERSION = 1;
+
+// catches truncated or corrupted files
+uint64_t hashData(const char *data, size_t size) {
+    Hasher hasher;
+    hasher.add(data, size);
+    return hasher.get();
+}
+
+} // namespace
+
+void PipelineCache::init(Device *device, const std::string &path) {
+    this->device = device;
+    this->path = path;
+
+    auto initialData = load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(*device->getDevice(), &cacheInfo, nullptr,
+                              &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+void PipelineCache::cleanup() {
+    if (cache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // a cache that can't be written only costs the next start some time
+    try {
+        save();
+    } catch (const std::exception &) {
+    }
+
+    vkDestroyPipelineCache(*device->getDevice(), cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
+
+PipelineCache::FileHeader PipelineCache::expectedHeader() const {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(*device->getPhysicalDevice(), &properties);
+
+    FileHeader header{};
+    header.magic = CACHE_FILE_MAGIC;
+    header.headerVersion = CACHE_FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID,
+                VK_UUID_SIZE);
+    return header;
+}
+
+std::vector<char> PipelineCache::load() const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    FileHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return {};
+    }
+
+    auto expected = expectedHeader();
+    if (header.magic != expected.magic ||
+        header.headerVersion != expected.headerVersion ||
+        header.vendorID != expected.vendorID ||
+        header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID,
+                    VK_UUID_SIZE) != 0) {
+        return {};
+    }
+
+    auto dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    if (static_cast<uint64_t>(file.tellg() - dataStart) != header.dataSize) {
+        return {};
+    }
+    file.seekg(dataStart);
+
+    std::vector<char> data(header.dataSize);
+    if (!file.read(data.data(), data.size()) ||
+        hashData(data.data(), data.size()) != header.dataHash) {
+        return {};
+    }
+    return data;
+}
+
+void PipelineCache::save() const {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(*device->getDevice(), cache, &dataSize,
+                               nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get pipeline cache size!");
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(*device->getDevice(), cache, &dataSize,
+                               data.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get pipeline cache data!");
+    }
+    data.resize(dataSize);
+
+    auto header = expectedHeader();
+    header.dataSize = data.size();
+    header.dataHash = hashData(data.data(), data.size());
+
+    // write next to the old file and swap it in, so a crash mid-write never
+    // leaves a half written cache behind
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char *>(&header),
+                        sizeof(header)) ||
+            !file.write(data.data(), data.size())) {
+            throw std::runtime_error("failed to write pipeline cache!");
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        throw std::runtime_error("failed to replace pipeline cache file!");
+    }
+}
@@ -1,15 +1,31 @@
 #include "DescriptorLayout.h"
+#include "Hash.h"
+#include "InstanceData.h"
 #include "Pipeline.h"
 #include "PipelineManager.h"
 #include <stdexcept>
 
-void PipelineManager::init(Device *device) { this->device = device; }
+void PipelineManager::init(Device *device, ThreadPool &threads,
+                           const std::string &cachePath) {
+    this->device = device;
+    compileThreads = &threads;
+    cache.init(device, cachePath);
+}
 
 void PipelineManager::cleanup() {
-    for (auto &pipeline : pipelines) {
-        pipeline.second->cleanup();
+    // the pool is shared, only wait for the pipelines of this manager
+    waitAll();
+
+    for (auto &[id, entry] : pipelines) {
+        try {
+            entry.pipeline.get()->cleanup();
+        } catch (const std::exception &) {
+            // creation failed, nothing to destroy
+        }
     }
     pipelines.clear();
+    sources.clear();
+    cache.cleanup();
 }
 
 PipelineID PipelineManager::createPipeline(DescriptorLayout descriptorLayout,
@@ -17,32 +33,158 @@ PipelineID PipelineManager::createPipeline(DescriptorLayout descriptorLayout,
                                            VkFormat depthFormat,
                                            uint32_t maxFramesInFlight,
                                            PipelineSettings &settings) {
+    PipelineID id =
+        createPipelineAsync(std::move(descriptorLayout), colorFormat,
+                            depthFormat, maxFramesInFlight, settings);
+    try {
+        getPipeline(id);
+    } catch (...) {
+        // let a later call retry instead of caching the failure
+        pipelines.erase(id);
+        for (auto it = sources.begin(); it != sources.end();) {
+            it = it->second == id ? sources.erase(it) : std::next(it);
+        }
+        throw;
+    }
+    return id;
+}
+
+PipelineID PipelineManager::createPipelineAsync(
+    DescriptorLayout descriptorLayout, VkFormat colorFormat,
+    VkFormat depthFormat, uint32_t maxFramesInFlight,
+    const PipelineSettings &settings) {
     if (!device) {
         throw std::runtime_error(
             "PipelineManager not initialized with device!");
     }
 
-    // Create a unique ID from the shader paths
-    PipelineID id =
-        settings.getVertexShaderPath() + ":" + settings.getFragmentShaderPath();
+    SourceKey source{settings.getVertexShaderPath(),
+                     settings.getFragmentShaderPath(),
+                     stateKey(settings, colorFormat, depthFormat)};
+    if (auto it = sources.find(source); it != sources.end()) {
+        descriptorLayout.cleanup();
+        return it->second;
+    }
 
-    // Check if pipeline already exists
-    if (pipelines.find(id) != pipelines.end()) {
-        return id;
+    auto vertexShaderCode = Pipeline::readFile(source.vertexShaderPath);
+    auto fragmentShaderCode = Pipeline::readFile(source.fragmentShaderPath);
+
+    Hasher hasher;
+    hasher.add(vertexShaderCode);
+    hasher.add(fragmentShaderCode);
+    hasher.add(source.state);
+    PipelineID id = hasher.get();
+
+    // probe past colliding ids, the same SPIR-V from other paths is reused
+    for (auto it = pipelines.find(id); it != pipelines.end();
+         it = pipelines.find(++id)) {
+        const Entry &entry = it->second;
+        if (entry.vertexShaderCode == vertexShaderCode &&
+            entry.fragmentShaderCode == fragmentShaderCode &&
+            entry.state == source.state) {
+            descriptorLayout.cleanup();
+            sources.emplace(std::move(source), id);
+            return id;
+        }
     }
 
-    // Create new pipeline and move it into the map
-    pipelines.emplace(id, std::make_unique<Pipeline>(
-                              device, std::move(descriptorLayout), colorFormat,
-                              depthFormat, maxFramesInFlight, settings));
+    auto pipelineCache = cache.getCache();
+    auto device = this->device;
+    auto pending = compileThreads->submit(
+        [=, descriptorLayout = std::move(descriptorLayout)]() mutable {
+            return std::make_shared<Pipeline>(
+                device, std::move(descriptorLayout), colorFormat, depthFormat,
+                maxFramesInFlight, settings, vertexShaderCode,
+                fragmentShaderCode, pipelineCache);
+        });
+    pipelines.emplace(id, Entry{std::move(vertexShaderCode),
+                                std::move(fragmentShaderCode), source.state,
+                                pending.share()});
+    sources.emplace(std::move(source), id);
 
     return id;
 }
 
+std::vector<PipelineID>
+PipelineManager::createPipelines(std::vector<PipelineRequest> requests) {
+    std::vector<PipelineID> ids;
+    ids.reserve(requests.size());
+    for (auto &request : requests) {
+        ids.push_back(createPipelineAsync(
+            std::move(request.descriptorLayout), request.colorFormat,
+            request.depthFormat, request.maxFramesInFlight, request.settings));
+    }
+    return ids;
+}
+
+bool PipelineManager::isReady(const PipelineID &id) const {
+    return find(id).wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+}
+
+void PipelineManager::waitAll() const {
+    for (auto &[id, entry] : pipelines) {
+        entry.pipeline.wait();
+    }
+}
+
 Pipeline &PipelineManager::getPipeline(const PipelineID &id) const {
+    return *find(id).get();
+}
+
+std::vector<uint64_t>
+PipelineManager::stateKey(const PipelineSettings &settings,
+                          VkFormat colorFormat, VkFormat depthFormat) {
+    std::vector<uint64_t> key;
+    auto add = [&](auto... values) {
+        (key.push_back(static_cast<uint64_t>(values)), ...);
+    };
+
+    // the vertex input layout is fixed today, keying on it keeps pipelines
+    // apart once that changes
+    for (auto &binding : {Vertex::getBindingDescription(),
+                          InstanceData::getBindingDescription()}) {
+        add(binding.binding, binding.stride, binding.inputRate);
+    }
+    auto addAttributes = [&](const auto &attributes) {
+        for (auto &attribute : attributes) {
+            add(attribute.location, attribute.binding, attribute.format,
+                attribute.offset);
+        }
+    };
+    addAttributes(Vertex::getAttributeDescriptions());
+    addAttributes(InstanceData::getAttributeDescriptions());
+
+    for (auto &attachment : settings.getAttachments()) {
+        auto binding = attachment.get().layoutBinding();
+        add(binding.binding, binding.descriptorType, binding.descriptorCount,
+            binding.stageFlags);
+    }
+
+    add(colorFormat, depthFormat);
+
+    const auto &state = settings.getState();
+    add(state.blendEnable, state.cullMode, state.depthTestEnable,
+        state.depthWriteEnable, state.depthCompareOp, state.colorWriteMask);
+
+    return key;
+}
+
+size_t PipelineManager::SourceKeyHash::operator()(const SourceKey &key) const {
+    Hasher hasher;
+    for (auto &path : {&key.vertexShaderPath, &key.fragmentShaderPath}) {
+        hasher.add(path->size());
+        hasher.add(path->data(), path->size());
+    }
+    hasher.add(key.state);
+    return hasher.get();
+}
+
+const PipelineManager::PendingPipeline &
+PipelineManager::find(const PipelineID &id) const {
     auto it = pipelines.find(id);
     if (it == pipelines.end()) {
         throw std::runtime_error("Pipeline not found!");
     }
-    return *it->second;
+    return it->second.pipeline;
 }
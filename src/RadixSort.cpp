@@ -0,0 +1,45 @@
+#include "RadixSort.h"
+#include <array>
+#include <cstddef>
+
+void radixSort(std::vector<SortEntry> &entries,
+               std::vector<SortEntry> &scratch) {
+    constexpr int RADIX_BITS = 8;
+    constexpr size_t BUCKETS = 1 << RADIX_BITS;
+    constexpr int PASSES = 64 / RADIX_BITS;
+
+    if (entries.size() < 2) {
+        return;
+    }
+
+    // histograms of all passes in one sweep
+    std::array<std::array<size_t, BUCKETS>, PASSES> counts{};
+    for (const auto &entry : entries) {
+        for (int pass = 0; pass < PASSES; pass++) {
+            uint64_t shift = pass * RADIX_BITS;
+            counts[pass][(entry.key >> shift) & (BUCKETS - 1)]++;
+        }
+    }
+
+    scratch.resize(entries.size());
+    for (int pass = 0; pass < PASSES; pass++) {
+        auto &count = counts[pass];
+        uint64_t shift = pass * RADIX_BITS;
+        size_t firstBucket = (entries[0].key >> shift) & (BUCKETS - 1);
+        if (count[firstBucket] == entries.size()) {
+            continue;
+        }
+
+        std::array<size_t, BUCKETS> offsets;
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+            offsets[bucket] = offset;
+            offset += count[bucket];
+        }
+
+        for (const auto &entry : entries) {
+            scratch[offsets[(entry.key >> shift) & (BUCKETS - 1)]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
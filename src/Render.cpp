@@ -1,16 +1,59 @@
 #include "Render.h"
+#include <algorithm>
+#include <cstring>
+#include <future>
 #include <stdexcept>
+#include <unordered_set>
 
 Render::Render(GlobalResources *globalResources, VkCommandBuffer commandBuffer,
                uint32_t imageIndex, uint32_t currentFrame,
                VkSemaphore imageAvailableSemaphore,
-               VkSemaphore renderFinishedSemaphore, VkFence inFlightFence,
-               Camera &camera)
+               VkSemaphore renderFinishedSemaphore, Camera &camera)
     : globalResources(globalResources), commandBuffer(commandBuffer),
       imageIndex(imageIndex), currentFrame(currentFrame),
       imageAvailableSemaphore(imageAvailableSemaphore),
       renderFinishedSemaphore(renderFinishedSemaphore),
-      inFlightFence(inFlightFence), camera(camera) {
+      camera(camera), state(commandBuffer) {}
+
+void Render::submit(Renderable &renderable) {
+    if (isFinished) {
+        throw std::runtime_error("Cannot submit to a finished render!");
+    }
+
+    // Recording is deferred to finish(), compute pre-passes have to be
+    // recorded before the rendering begins
+    submitted.push_back(&renderable);
+}
+
+void Render::prepareRenderables() {
+    auto extent = globalResources->getSwapChain().getExtent();
+    float aspectRatio = extent.width / static_cast<float>(extent.height);
+    auto frustum = Frustum::fromMatrix(camera.getProjectionMatrix(aspectRatio) *
+                                       camera.GetViewMatrix());
+
+    // attachments are often shared between renderables, update each once
+    std::unordered_set<IAttachment *> updatedAttachments;
+    for (auto renderable : submitted) {
+        for (auto &attachment : renderable->getAttachments()) {
+            if (updatedAttachments.insert(&attachment.get()).second) {
+                attachment.get().update(currentFrame);
+            }
+        }
+    }
+
+    for (auto renderable : submitted) {
+        renderable->getInstances().flush(currentFrame);
+
+        if (auto culler = renderable->getCuller()) {
+            culler->record(commandBuffer, currentFrame, frustum);
+        }
+        if (auto cpuCuller = renderable->getCpuCuller()) {
+            cpuCuller->cull(frustum);
+        }
+    }
+}
+
+void Render::beginRendering(VkRenderingFlags flags) {
     auto &swapChain = globalResources->getSwapChain();
 
     // Setup rendering info
@@ -32,6 +75,7 @@ Render::Render(GlobalResources *globalResources, VkCommandBuffer commandBuffer,
 
     VkRenderingInfoKHR renderingInfo{};
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = flags;
     renderingInfo.colorAttachmentCount = 1;
     renderingInfo.pColorAttachments = &colorAttachmentInfo;
     renderingInfo.pDepthAttachment = &depthAttachmentInfo;
@@ -42,64 +86,259 @@ Render::Render(GlobalResources *globalResources, VkCommandBuffer commandBuffer,
     vkCmdBeginRendering(commandBuffer, &renderingInfo);
 }
 
-void Render::submit(Renderable &renderable) {
-    if (isFinished) {
-        throw std::runtime_error("Cannot submit to a finished render!");
+namespace {
+
+// Below this many draws per chunk the thread handoff costs more than the
+// recording it saves
+constexpr size_t MIN_DRAWS_PER_CHUNK = 128;
+
+// Sort key layout, most significant bits first:
+//   opaque:      phase:2 | pipeline:10 | set:10 | mesh:10 | depth:32
+//   translucent: phase:2 | far-to-near depth:32 | pipeline:10 | set:10 |
+//                mesh:10
+// Depth pre-pass draws come first, translucent ones last.
+enum DrawPhase : uint64_t {
+    DEPTH_PREPASS_PHASE = 0,
+    OPAQUE_PHASE = 1,
+    TRANSLUCENT_PHASE = 2,
+};
+
+constexpr uint32_t ORDINAL_BITS = 10;
+constexpr uint32_t MAX_ORDINAL = (1u << ORDINAL_BITS) - 1;
+
+template <typename Handle>
+uint64_t ordinal(std::unordered_map<Handle, uint32_t> &ordinals,
+                 Handle handle) {
+    auto next = static_cast<uint32_t>(ordinals.size());
+    // past the limit keys only lose the grouping, not correctness
+    return std::min(ordinals.try_emplace(handle, next).first->second,
+                    MAX_ORDINAL);
+}
+
+// Non-negative floats order like their bit patterns
+uint64_t depthBits(float depth) {
+    depth = std::max(depth, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+uint64_t Render::makeSortKey(const DrawItem &item, float depth, VkBuffer mesh,
+                             uint32_t sequence) {
+    uint64_t phase = item.depthPrepass ? DEPTH_PREPASS_PHASE
+                     : item.renderable->isTranslucent() ? TRANSLUCENT_PHASE
+                                                        : OPAQUE_PHASE;
+    if (!sortDraws) {
+        return phase << 62 | sequence;
+    }
+
+    PipelineID pipelineId = item.depthPrepass
+                                ? item.renderable->getDepthPipelineId()
+                                : item.renderable->getPipelineId();
+    uint64_t state =
+        ordinal(pipelineOrdinals, pipelineId) << (2 * ORDINAL_BITS) |
+        ordinal(setOrdinals, item.renderable->getDescriptorSet(currentFrame))
+            << ORDINAL_BITS |
+        ordinal(meshOrdinals, mesh);
+
+    if (phase == TRANSLUCENT_PHASE) {
+        uint64_t farToNear = 0xffffffffu - depthBits(depth);
+        return phase << 62 | farToNear << 30 | state;
+    }
+    return phase << 62 | state << 32 | depthBits(depth);
+}
+
+void Render::collectDrawItems() {
+    drawItems.clear();
+    sortEntries.clear();
+
+    glm::vec3 viewPosition = camera.Position;
+    glm::vec3 viewDirection = camera.Front;
+    auto &meshManager = globalResources->getMeshManager();
+
+    auto addItem = [&](const DrawItem &item, float depth, VkBuffer mesh) {
+        auto index = static_cast<uint32_t>(drawItems.size());
+        sortEntries.push_back({makeSortKey(item, depth, mesh, index), index});
+        drawItems.push_back(item);
+    };
+
+    for (auto renderable : submitted) {
+        for (bool depthPrepass : {true, false}) {
+            if (depthPrepass && !renderable->hasDepthPrepass()) {
+                continue;
+            }
+
+            // indirect groups have no useful position, they span the whole
+            // renderable and are only sorted by state
+            if (renderable->usesIndirectDraws()) {
+                auto &groups = renderable->getIndirectGroups();
+                for (uint32_t i = 0; i < groups.size(); i++) {
+                    addItem({renderable, i, depthPrepass}, 0.0f,
+                            groups[i].vertexBuffer);
+                }
+                continue;
+            }
+
+            // pass bounds are only known with CPU culling
+            auto cpuCuller = renderable->getCpuCuller();
+            auto &passes = renderable->getRenderPasses();
+            for (uint32_t i = 0; i < passes.size(); i++) {
+                if (cpuCuller && !cpuCuller->isVisible(i)) {
+                    continue;
+                }
+                float depth = 0.0f;
+                if (cpuCuller) {
+                    auto &bounds = cpuCuller->getPassBounds(i);
+                    depth = glm::dot(bounds.center - viewPosition,
+                                     viewDirection);
+                }
+                auto mesh = meshManager.getMesh(passes[i].getMeshId());
+                addItem({renderable, i, depthPrepass}, depth,
+                        mesh->vertexBuffer);
+            }
+        }
     }
 
-    recordRenderingCommands(renderable);
+    radixSort(sortEntries, sortScratch);
 }
 
-void Render::recordRenderingCommands(Renderable &renderable) {
-    for (RenderPass &pass : renderable.getRenderPasses()) {
-        recordRenderingCommands(pass);
+size_t Render::countRecordingChunks() const {
+    if (!parallelRecording) {
+        return 0;
     }
+    auto &recorder = globalResources->getParallelRecorder();
+    size_t chunks = std::min(recorder.getChunkCount(),
+                             sortEntries.size() / MIN_DRAWS_PER_CHUNK);
+    return chunks > 1 ? chunks : 0;
 }
 
-void Render::recordRenderingCommands(RenderPass &pass) {
+void Render::recordChunks(size_t chunkCount) {
+    auto &recorder = globalResources->getParallelRecorder();
     auto &swapChain = globalResources->getSwapChain();
+    VkFormat colorFormat = swapChain.getImageFormat();
+    VkFormat depthFormat = swapChain.findDepthFormat();
+
+    // workers must not block on pipeline compilation, and only read the
+    // pipeline map afterwards
+    auto &pipelineManager = globalResources->getPipelineManager();
+    for (auto &item : drawItems) {
+        pipelineManager.getPipeline(item.depthPrepass
+                                        ? item.renderable->getDepthPipelineId()
+                                        : item.renderable->getPipelineId());
+    }
+
+    // the frame slot's previous submission has retired, its secondaries are
+    // free again
+    recorder.beginFrame(currentFrame);
+
+    // contiguous ranges keep the sorted order when executed one after another
+    std::vector<VkCommandBuffer> secondaries(chunkCount);
+    std::vector<std::future<void>> recorded;
+    size_t count = sortEntries.size();
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        size_t first = count * chunk / chunkCount;
+        size_t last = count * (chunk + 1) / chunkCount;
+        auto recordChunk = [&, chunk, first, last] {
+            VkCommandBuffer secondary = recorder.beginChunk(
+                currentFrame, chunk, colorFormat, depthFormat);
+            // nothing is inherited from the primary command buffer
+            RenderStateTracker tracker(secondary);
+            for (size_t i = first; i < last; i++) {
+                recordDrawItem(tracker, secondary,
+                               drawItems[sortEntries[i].index]);
+            }
+            if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+                throw std::runtime_error(
+                    "Failed to record secondary command buffer!");
+            }
+            secondaries[chunk] = secondary;
+        };
+        // pipeline compiles share the pool, the frame must not queue behind
+        recorded.push_back(recorder.getThreads().submit(
+            recordChunk, ThreadPool::Priority::High));
+    }
 
-    auto &pipeline =
-        globalResources->getPipelineManager().getPipeline(pass.getPipelineId());
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      pipeline.getPipeline());
-    pass.update(currentFrame);
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChain.getExtent().width);
-    viewport.height = static_cast<float>(swapChain.getExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChain.getExtent();
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    // every task references this frame, all of them have to finish before
+    // a failure is rethrown
+    for (auto &future : recorded) {
+        future.wait();
+    }
+    for (auto &future : recorded) {
+        future.get();
+    }
+
+    vkCmdExecuteCommands(commandBuffer,
+                         static_cast<uint32_t>(secondaries.size()),
+                         secondaries.data());
+}
 
+void Render::recordDrawItem(RenderStateTracker &tracker,
+                            VkCommandBuffer target, const DrawItem &item) {
+    auto &swapChain = globalResources->getSwapChain();
+    auto &renderable = *item.renderable;
+
+    auto &pipeline = globalResources->getPipelineManager().getPipeline(
+        item.depthPrepass ? renderable.getDepthPipelineId()
+                          : renderable.getPipelineId());
+    tracker.bindPipeline(pipeline.getPipeline());
+    tracker.setViewportAndScissor(swapChain.getExtent());
+
+    // binding 1 holds the per-instance data
+    tracker.bindVertexBuffer(1, renderable.getInstanceBuffer(currentFrame));
+
+    // renderables with the same pipeline and attachments share their sets
+    tracker.bindDescriptorSet(pipeline.getLayout(),
+                              renderable.getDescriptorSet(currentFrame));
+
+    if (renderable.usesIndirectDraws()) {
+        recordIndirectCommands(tracker, target, renderable,
+                               renderable.getIndirectGroups()[item.index]);
+    } else {
+        recordRenderingCommands(tracker, target,
+                                renderable.getRenderPasses()[item.index]);
+    }
+}
+
+void Render::recordRenderingCommands(RenderStateTracker &tracker,
+                                     VkCommandBuffer target,
+                                     RenderPass &pass) {
     auto mesh = globalResources->getMeshManager().getMesh(pass.getMeshId());
-    VkBuffer vertexBuffers[] = {mesh->vertexBuffer->getBuffer()};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    // meshes in shared storage mostly use the same buffers
+    tracker.bindVertexBuffer(0, mesh->vertexBuffer);
+    tracker.bindIndexBuffer(mesh->indexBuffer, mesh->indexType);
 
-    VkBuffer instanceDataBuffers[] = {pass.getInstanceBuffer()};
-    VkDeviceSize instanceOffsets[] = {0};
+    vkCmdDrawIndexed(target, mesh->indexCount, pass.getInstanceCount(),
+                     mesh->firstIndex, mesh->vertexOffset,
+                     pass.getFirstInstance());
+}
 
-    vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceDataBuffers,
-                           instanceOffsets);
+void Render::recordIndirectCommands(RenderStateTracker &tracker,
+                                    VkCommandBuffer target,
+                                    Renderable &renderable,
+                                    const IndirectDrawGroup &group) {
+    bool multiDraw = globalResources->getDevice()
+                         ->getEnabledFeatures()
+                         .multiDrawIndirect;
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    VkBuffer indirectBuffer = renderable.getIndirectBuffer(currentFrame);
 
-    vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer->getBuffer(), 0,
-                         VK_INDEX_TYPE_UINT16);
+    tracker.bindVertexBuffer(0, group.vertexBuffer);
+    tracker.bindIndexBuffer(group.indexBuffer, group.indexType);
 
-    auto currentDescriptorSet = pass.getDescriptorSet(currentFrame);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipeline.getLayout(), 0, 1, &currentDescriptorSet,
-                            0, nullptr);
+    VkDeviceSize offset = group.firstCommand * stride;
+    if (multiDraw) {
+        vkCmdDrawIndexedIndirect(target, indirectBuffer, offset,
+                                 group.commandCount, stride);
+        return;
+    }
 
-    vkCmdDrawIndexed(commandBuffer, mesh->indexCount, pass.getInstanceCount(),
-                     0, 0, 0);
+    // without multiDrawIndirect every command needs its own call
+    for (uint32_t i = 0; i < group.commandCount; i++) {
+        vkCmdDrawIndexedIndirect(target, indirectBuffer,
+                                 offset + i * stride, 1, stride);
+    }
 }
 
 void Render::submitCommandBuffer() {
@@ -115,12 +354,24 @@ void Render::submitCommandBuffer() {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
+    // the binary semaphore gates presentation, the timeline value marks the
+    // frame as retired
+    auto &timeline = globalResources->getDevice()->getTimeline();
+    completionValue = timeline.advance();
+    VkSemaphore signalSemaphores[] = {renderFinishedSemaphore,
+                                      timeline.getSemaphore()};
+    uint64_t signalValues[] = {0, completionValue};
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
     if (globalResources->getDevice()->submitToAvailableGraphicsQueue(
-            &submitInfo, inFlightFence) != VK_SUCCESS) {
+            &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer!");
     }
 }
@@ -131,6 +382,22 @@ bool Render::finish() {
     }
     auto &swapChain = globalResources->getSwapChain();
 
+    prepareRenderables();
+    collectDrawItems();
+
+    // The depth pre-pass draws sort first, so the shading pass only runs the
+    // fragment shader for the visible surface
+    size_t chunkCount = countRecordingChunks();
+    if (chunkCount > 0) {
+        beginRendering(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+        recordChunks(chunkCount);
+    } else {
+        beginRendering();
+        for (auto &entry : sortEntries) {
+            recordDrawItem(state, commandBuffer, drawItems[entry.index]);
+        }
+    }
+
     vkCmdEndRendering(commandBuffer);
 
     // Use SwapChain's transition method
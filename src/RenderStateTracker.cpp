@@ -0,0 +1,75 @@
+#include "RenderStateTracker.h"
+
+void RenderStateTracker::reset() {
+    pipeline = VK_NULL_HANDLE;
+    pipelineLayout = VK_NULL_HANDLE;
+    descriptorSet = VK_NULL_HANDLE;
+    vertexBuffers.fill(VK_NULL_HANDLE);
+    indexBuffer = VK_NULL_HANDLE;
+    viewportExtent = {0, 0};
+}
+
+void RenderStateTracker::bindPipeline(VkPipeline pipeline) {
+    if (pipeline == this->pipeline) {
+        return;
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pipeline);
+    this->pipeline = pipeline;
+}
+
+void RenderStateTracker::bindDescriptorSet(VkPipelineLayout layout,
+                                           VkDescriptorSet set) {
+    if (set == descriptorSet && layout == pipelineLayout) {
+        return;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            layout, 0, 1, &set, 0, nullptr);
+    descriptorSet = set;
+    pipelineLayout = layout;
+}
+
+void RenderStateTracker::bindVertexBuffer(uint32_t binding, VkBuffer buffer) {
+    bool tracked = binding < MAX_VERTEX_BINDINGS;
+    if (tracked && vertexBuffers[binding] == buffer) {
+        return;
+    }
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &offset);
+    if (tracked) {
+        vertexBuffers[binding] = buffer;
+    }
+}
+
+void RenderStateTracker::bindIndexBuffer(VkBuffer buffer,
+                                         VkIndexType indexType) {
+    if (buffer == indexBuffer && indexType == this->indexType) {
+        return;
+    }
+    vkCmdBindIndexBuffer(commandBuffer, buffer, 0, indexType);
+    indexBuffer = buffer;
+    this->indexType = indexType;
+}
+
+void RenderStateTracker::setViewportAndScissor(VkExtent2D extent) {
+    if (extent.width == viewportExtent.width &&
+        extent.height == viewportExtent.height) {
+        return;
+    }
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    viewportExtent = extent;
+}
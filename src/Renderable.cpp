@@ -1,29 +1,243 @@
 #include "Renderable.h"
+#include "InstanceDataBuilder.h"
+#include "UploadContext.h"
 #include <algorithm>
+#include <stdexcept>
+#include <tuple>
 
 Renderable::Renderable(GlobalResources *resources, Model &model,
-                       PipelineSettings &settings)
-    : resources(resources) {
+                       PipelineSettings &settings,
+                       const RenderableOptions &options)
+    : resources(resources), attachments(settings.getAttachments()) {
     auto device = resources->getDevice();
-    DescriptorLayout descriptorLayout(*device->getDevice(),
-                                      settings.getAttachments());
 
     // TODO: move things like this into the resources class
     auto maxFramesInFlight = resources->getDevice()->getMaxFramesInFlight();
 
+    createPipelines(settings, options.depthPrepass, maxFramesInFlight);
+
+    // firstInstance of indirect commands has to be zero without this feature
+    bool indirect = options.indirect &&
+                    device->getEnabledFeatures().drawIndirectFirstInstance;
+
+    // GPU culling needs the indirect path, otherwise cull on the CPU. CPU
+    // culling skips whole passes, so it needs a draw call per pass.
+    bool cpuCulling =
+        options.cpuCulling || (options.frustumCulling && !indirect);
+    if (cpuCulling) {
+        cpuCuller = std::make_unique<CpuCuller>();
+        indirect = false;
+    }
+
+    createPasses(model, options.dynamicInstances, maxFramesInFlight);
+
+    if (indirect) {
+        createIndirectBuffer(options.frustumCulling, maxFramesInFlight);
+    }
+
+    createDescriptorSets(maxFramesInFlight);
+}
+
+Renderable::~Renderable() {
+    if (descriptorSet) {
+        resources->getDescriptorSets().release(*descriptorSet);
+    }
+}
+
+void Renderable::createPipelines(const PipelineSettings &settings,
+                                 bool depthPrepass,
+                                 uint32_t maxFramesInFlight) {
+    auto device = resources->getDevice();
+    auto &pipelineManager = resources->getPipelineManager();
     VkFormat colorFormat = resources->getSwapChain().getImageFormat();
     VkFormat depthFormat = resources->getSwapChain().findDepthFormat();
 
-    auto pipelineId = resources->getPipelineManager().createPipeline(
-        descriptorLayout, colorFormat, depthFormat, maxFramesInFlight,
-        settings);
+    // translucent pipelines can't go into the pre-pass, they would hide
+    // what is behind them
+    const auto &state = settings.getState();
+    translucent = state.blendEnable;
+    this->depthPrepass =
+        depthPrepass && !state.blendEnable && state.depthWriteEnable;
+
+    // The pipelines compile in the background while the instance data is
+    // built, the descriptor sets are the first thing that needs them
+    PipelineSettings shading = settings;
+    if (this->depthPrepass) {
+        // The pre-pass uses the same vertex shader, so the depth of every
+        // visible fragment matches exactly
+        PipelineSettings depthOnly(settings.getVertexShaderPath(),
+                                   SHADER_DIR "depth.spv");
+        for (auto &attachment : settings.getAttachments()) {
+            depthOnly.bind(attachment.get());
+        }
+        auto depthState = PipelineState::depthOnly();
+        depthState.cullMode = state.cullMode;
+        depthState.depthCompareOp = state.depthCompareOp;
+        depthOnly.setState(depthState);
 
-    for (auto &batch : model.getBatches()) {
-        passes.emplace_back(resources, batch, pipelineId, maxFramesInFlight);
+        depthPipelineId = pipelineManager.createPipelineAsync(
+            DescriptorLayout(*device->getDevice(), settings.getAttachments()),
+            colorFormat, depthFormat, maxFramesInFlight, depthOnly);
+
+        shading.getState().depthCompareOp = VK_COMPARE_OP_EQUAL;
+        shading.getState().depthWriteEnable = false;
     }
+
+    pipelineId = pipelineManager.createPipelineAsync(
+        DescriptorLayout(*device->getDevice(), settings.getAttachments()),
+        colorFormat, depthFormat, maxFramesInFlight, shading);
 }
 
-Renderable::~Renderable() {
-    std::for_each(passes.begin(), passes.end(),
-                  [](auto &pass) { pass.cleanUp(); });
+void Renderable::createPasses(Model &model, bool dynamicInstances,
+                              uint32_t maxFramesInFlight) {
+    auto &meshManager = resources->getMeshManager();
+    auto &batches = model.getBatches();
+
+    // Order the batches by the buffers their meshes live in, so passes that
+    // can share bindings end up next to each other
+    std::vector<size_t> order(batches.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        auto meshA = meshManager.getMesh(batches[a].meshId);
+        auto meshB = meshManager.getMesh(batches[b].meshId);
+        return std::tie(meshA->vertexBuffer, meshA->indexBuffer,
+                        meshA->indexType) < std::tie(meshB->vertexBuffer,
+                                                     meshB->indexBuffer,
+                                                     meshB->indexType);
+    });
+
+    passOfBatch.resize(batches.size());
+
+    std::vector<InstanceData> instanceData;
+    for (size_t index : order) {
+        auto &batch = batches[index];
+        passOfBatch[index] = passes.size();
+        auto batchData =
+            buildInstanceData(batch.instances, &resources->getThreads());
+
+        passes.emplace_back(batch.meshId,
+                            static_cast<uint32_t>(instanceData.size()),
+                            static_cast<uint32_t>(batchData.size()));
+
+        if (cpuCuller) {
+            auto &meshBounds = meshManager.getMesh(batch.meshId)->bounds;
+            std::vector<BoundingSphere> instanceSpheres;
+            instanceSpheres.reserve(batchData.size());
+            for (auto &data : batchData) {
+                instanceSpheres.push_back(
+                    transformSphere(meshBounds, data.transform));
+            }
+            cpuCuller->addPass(instanceSpheres);
+        }
+
+        instanceData.insert(instanceData.end(), batchData.begin(),
+                            batchData.end());
+    }
+
+    instanceBuffer = std::make_unique<InstanceBuffer>(
+        resources->getDevice(), instanceData, dynamicInstances,
+        maxFramesInFlight);
+}
+
+void Renderable::createDescriptorSets(uint32_t maxFramesInFlight) {
+    auto &pipeline = resources->getPipelineManager().getPipeline(pipelineId);
+
+    // renderables sharing the pipeline and the attachment objects share the
+    // sets, the depth pre-pass pipeline has a compatible layout
+    descriptorSet = &resources->getDescriptorSets().get(
+        pipelineId, pipeline.getDescriptorLayout(), attachments,
+        maxFramesInFlight);
+}
+
+void Renderable::createIndirectBuffer(bool frustumCulling,
+                                      uint32_t maxFramesInFlight) {
+    auto &meshManager = resources->getMeshManager();
+
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    commands.reserve(passes.size());
+
+    for (auto &pass : passes) {
+        auto mesh = meshManager.getMesh(pass.getMeshId());
+
+        if (indirectGroups.empty() ||
+            indirectGroups.back().vertexBuffer != mesh->vertexBuffer ||
+            indirectGroups.back().indexBuffer != mesh->indexBuffer ||
+            indirectGroups.back().indexType != mesh->indexType) {
+            indirectGroups.push_back({mesh->vertexBuffer, mesh->indexBuffer,
+                                      mesh->indexType,
+                                      static_cast<uint32_t>(commands.size()),
+                                      0});
+        }
+        indirectGroups.back().commandCount++;
+
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = mesh->indexCount;
+        command.instanceCount = pass.getInstanceCount();
+        command.firstIndex = mesh->firstIndex;
+        command.vertexOffset = mesh->vertexOffset;
+        command.firstInstance = pass.getFirstInstance();
+        commands.push_back(command);
+    }
+
+    VkDeviceSize bufferSize =
+        sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+    indirectBuffer = std::make_unique<Buffer>(
+        resources->getDevice(), std::max<VkDeviceSize>(bufferSize, 1),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    resources->getDevice()->getUploadContext().uploadToBuffer(
+        *indirectBuffer, commands.data(), bufferSize);
+
+    if (!frustumCulling) {
+        return;
+    }
+
+    std::vector<uint32_t> drawOfInstance;
+    std::vector<glm::vec4> drawBounds;
+    for (uint32_t draw = 0; draw < passes.size(); draw++) {
+        auto &bounds = meshManager.getMesh(passes[draw].getMeshId())->bounds;
+        drawBounds.emplace_back(bounds.center, bounds.radius);
+        drawOfInstance.insert(drawOfInstance.end(),
+                              passes[draw].getInstanceCount(), draw);
+    }
+
+    std::vector<VkBuffer> instanceBuffers;
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        instanceBuffers.push_back(instanceBuffer->getBuffer(i));
+    }
+
+    culler = std::make_unique<InstanceCuller>(
+        resources, instanceBuffers, commands, drawOfInstance, drawBounds,
+        maxFramesInFlight);
+}
+
+void Renderable::updateInstances(size_t batchIndex, uint32_t firstInstance,
+                                 const std::vector<Instance> &instances) {
+    size_t passIndex = passOfBatch.at(batchIndex);
+    auto &pass = passes[passIndex];
+    if (firstInstance + instances.size() > pass.getInstanceCount()) {
+        throw std::runtime_error("Instance update out of range!");
+    }
+
+    auto instanceData =
+        buildInstanceData(instances, &resources->getThreads());
+    instanceBuffer->update(pass.getFirstInstance() + firstInstance,
+                           instanceData.data(),
+                           static_cast<uint32_t>(instanceData.size()));
+
+    if (cpuCuller) {
+        auto &meshBounds =
+            resources->getMeshManager().getMesh(pass.getMeshId())->bounds;
+        std::vector<BoundingSphere> instanceSpheres;
+        instanceSpheres.reserve(instanceData.size());
+        for (auto &data : instanceData) {
+            instanceSpheres.push_back(
+                transformSphere(meshBounds, data.transform));
+        }
+        cpuCuller->updateSpheres(passIndex, firstInstance, instanceSpheres);
+    }
 }
@@ -0,0 +1,66 @@
+#include "StagingRing.h"
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing(Device *device, VkDeviceSize capacity)
+    : capacity(capacity) {
+    buffer = std::make_unique<Buffer>(
+        device, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VMA_MEMORY_USAGE_AUTO,
+        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+    void *data;
+    buffer->map(&data);
+    mapped = static_cast<char *>(data);
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment,
+                           uint64_t batch, VkDeviceSize &offset,
+                           void *&ptr) {
+    if (size > capacity) {
+        return false;
+    }
+
+    if (regions.empty()) {
+        // nothing in use, start over from the beginning
+        head = 0;
+        tail = 0;
+    }
+
+    VkDeviceSize start = alignUp(head, alignment);
+    if (regions.empty() || head > tail) {
+        // free space is [head, capacity) followed by [0, tail)
+        if (start + size > capacity) {
+            if (!regions.empty() && size > tail) {
+                return false;
+            }
+            // skip the rest of the buffer and wrap around
+            start = 0;
+        }
+    } else if (head == tail || start + size > tail) {
+        // either completely full or the gap before tail is too small
+        return false;
+    }
+
+    head = start + size;
+    if (!regions.empty() && regions.back().batch == batch) {
+        regions.back().end = head;
+    } else {
+        regions.push_back({batch, head});
+    }
+
+    offset = start;
+    ptr = mapped + start;
+    return true;
+}
+
+void StagingRing::release(uint64_t completedBatch) {
+    while (!regions.empty() && regions.front().batch <= completedBatch) {
+        tail = regions.front().end;
+        regions.pop_front();
+    }
+}
@@ -3,8 +3,10 @@
 #include <limits>
 #include <stdexcept>
 
-SwapChain::SwapChain(Device *device, AppWindow *appWindow)
-    : device(device), appWindow(appWindow), image(Image(*device)),
+SwapChain::SwapChain(Device *device, AppWindow *appWindow,
+                     const SwapChainSettings &settings)
+    : device(device), appWindow(appWindow), settings(settings),
+      image(Image(*device)),
       depthImage(Image(*device)) {
     init();
 }
@@ -32,6 +34,8 @@ void SwapChain::cleanup() {
 }
 
 void SwapChain::recreate() {
+    // released through the deferred deletion queue like any other image
+    cleanupDepthResources();
     for (auto imageView : swapChainImageViews) {
         vkDestroyImageView(*device->getDevice(), imageView, nullptr);
     }
@@ -45,14 +49,16 @@ void SwapChain::recreate() {
     init();
 }
 
+void SwapChain::applySettings(const SwapChainSettings &settings) {
+    this->settings = settings;
+    vkDeviceWaitIdle(*device->getDevice());
+    recreate();
+}
+
 void SwapChain::createExtent() {
     SwapChainSupportDetails swapChainSupport =
         device->querySwapChainSupportCurrent();
 
-    VkSurfaceFormatKHR surfaceFormat =
-        chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode =
-        chooseSwapPresentMode(swapChainSupport.presentModes);
     windowExtent = chooseSwapExtent(swapChainSupport.capabilities);
 };
 
@@ -62,14 +68,17 @@ void SwapChain::createSwapChain() {
 
     VkSurfaceFormatKHR surfaceFormat =
         chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode =
-        chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 &&
-        imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    auto &capabilities = swapChainSupport.capabilities;
+    uint32_t imageCount = settings.imageCount > 0
+                              ? settings.imageCount
+                              : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0 &&
+        imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
     }
 
     VkSwapchainCreateInfoKHR createInfo{};
@@ -137,9 +146,11 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
+    for (auto preferred : settings.presentModes) {
+        if (std::find(availablePresentModes.begin(),
+                      availablePresentModes.end(),
+                      preferred) != availablePresentModes.end()) {
+            return preferred;
         }
     }
     return VK_PRESENT_MODE_FIFO_KHR;
@@ -1,5 +1,5 @@
 #include "TextureAttachment.h"
-#include "Buffer.h"
+#include "UploadContext.h"
 
 TextureAttachment::TextureAttachment(Device *device,
                                      uint32_t max_texture_dimension,
@@ -50,15 +50,9 @@ void TextureAttachment::updateTextureArray(std::vector<TextureData> &textures) {
         totalSize += texture.width * texture.height * 4;
     }
 
-    Buffer stagingBuffer(
-        device, totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        VMA_MEMORY_USAGE_AUTO,
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    char *data;
-    stagingBuffer.map(reinterpret_cast<void **>(&data));
+    auto &uploads = device->getUploadContext();
+    auto staging = uploads.allocateStaging(totalSize);
+    char *data = static_cast<char *>(staging.mapped);
 
     VkDeviceSize offset = 0;
     std::vector<VkBufferImageCopy> copyRegions;
@@ -85,17 +79,8 @@ void TextureAttachment::updateTextureArray(std::vector<TextureData> &textures) {
         offset += imageSize;
     }
 
-    stagingBuffer.unmap();
-
-    textureImage->transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB,
-                                        VK_IMAGE_LAYOUT_UNDEFINED,
-                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    stagingBuffer.copyToImage(textureImage->getVkImage(), copyRegions);
-
-    textureImage->transitionImageLayout(
-        VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uploads.copyToImage(staging, *textureImage, VK_FORMAT_R8G8B8A8_SRGB,
+                        std::move(copyRegions));
 }
 
 void TextureAttachment::createSampler() {
@@ -0,0 +1,421 @@
+#include "UploadContext.h"
+#include "Image.h"
+#include <cstring>
+#include <stdexcept>
+
+// Everything on the graphics queue that might read uploaded data
+static constexpr VkPipelineStageFlags uploadConsumerStages =
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+static constexpr VkAccessFlags uploadConsumerAccess =
+    VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+static constexpr VkDeviceSize stagingRingSize = 64 * 1024 * 1024;
+
+UploadContext::UploadContext(Device *device)
+    : device(device), useTransferQueue(device->hasDedicatedTransferQueue()),
+      stagingRing(std::make_unique<StagingRing>(device, stagingRingSize)) {}
+
+UploadContext::~UploadContext() {
+    waitAll();
+
+    for (auto fence : freeFences) {
+        vkDestroyFence(*device->getDevice(), fence, nullptr);
+    }
+    for (auto semaphore : freeSemaphores) {
+        vkDestroySemaphore(*device->getDevice(), semaphore, nullptr);
+    }
+}
+
+VkCommandBuffer UploadContext::record() {
+    if (!recording) {
+        beginBatch();
+    }
+
+    if (!useTransferQueue) {
+        return recording->graphicsCommands->getCommandBuffer();
+    }
+
+    if (!recording->transferCommands) {
+        recording->transferCommands = obtainCommandBuffer(true);
+        recording->transferCommands->begin(
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    }
+    return recording->transferCommands->getCommandBuffer();
+}
+
+VkCommandBuffer UploadContext::recordGraphics() {
+    if (!recording) {
+        beginBatch();
+    }
+    return recording->graphicsCommands->getCommandBuffer();
+}
+
+StagingAllocation UploadContext::allocateStaging(VkDeviceSize size,
+                                                 VkDeviceSize alignment) {
+    // make sure there is a batch to tie the staging memory's lifetime to
+    record();
+
+    StagingAllocation allocation{};
+
+    if (size > stagingRing->getCapacity()) {
+        auto stagingBuffer = std::make_unique<Buffer>(
+            device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VMA_MEMORY_USAGE_AUTO,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+        allocation.buffer = stagingBuffer->getBuffer();
+        allocation.offset = 0;
+        stagingBuffer->map(&allocation.mapped);
+
+        recording->stagingBuffers.push_back(std::move(stagingBuffer));
+        return allocation;
+    }
+
+    while (!stagingRing->allocate(size, alignment, recording->token,
+                                  allocation.offset, allocation.mapped)) {
+        // The ring is full, wait for the oldest batch to give its space back.
+        // If only the current batch holds space, flush it first.
+        wait(inFlight.empty() ? recording->token : inFlight.front()->token);
+        record();
+    }
+
+    allocation.buffer = stagingRing->getBuffer();
+    return allocation;
+}
+
+void UploadContext::uploadToBuffer(Buffer &dstBuffer, const void *data,
+                                   VkDeviceSize size, VkDeviceSize dstOffset) {
+    if (size == 0) {
+        return;
+    }
+
+    auto staging = allocateStaging(size);
+    memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = staging.offset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(record(), staging.buffer, dstBuffer.getBuffer(), 1,
+                    &copyRegion);
+
+    if (useTransferQueue && !dstBuffer.isConcurrent()) {
+        releaseBuffer(dstBuffer, dstOffset, size);
+    }
+}
+
+void UploadContext::copyBuffer(Buffer &srcBuffer, Buffer &dstBuffer,
+                               VkDeviceSize size, VkDeviceSize srcOffset,
+                               VkDeviceSize dstOffset) {
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(recordGraphics(), srcBuffer.getBuffer(),
+                    dstBuffer.getBuffer(), 1, &copyRegion);
+}
+
+void UploadContext::copyToImage(const StagingAllocation &staging,
+                                Image &image, VkFormat format,
+                                std::vector<VkBufferImageCopy> regions) {
+    if (regions.empty()) {
+        return;
+    }
+
+    for (auto &region : regions) {
+        region.bufferOffset += staging.offset;
+    }
+
+    auto cmd = record();
+    image.recordTransitionLayout(cmd, format, VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    vkCmdCopyBufferToImage(cmd, staging.buffer, image.getVkImage(),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()),
+                           regions.data());
+
+    if (useTransferQueue) {
+        // the final layout transition happens as part of the ownership
+        // transfer, since the transfer queue has no fragment shader stage
+        releaseImage(image);
+    } else {
+        image.recordTransitionLayout(cmd, format,
+                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
+
+UploadToken UploadContext::submit() {
+    if (!recording) {
+        return lastSubmitted;
+    }
+
+    if (recording->transferCommands) {
+        submitOwnershipTransfers();
+    }
+
+    auto cmd = recording->graphicsCommands->getCommandBuffer();
+
+    // Make the copies visible to everything submitted after this batch, so
+    // draws don't need to know which uploads they depend on
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = uploadConsumerAccess;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         uploadConsumerStages, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+
+    recording->graphicsCommands->end();
+
+    std::vector<VkCommandBuffer> commandBuffers;
+    if (recording->acquireCommands) {
+        commandBuffers.push_back(
+            recording->acquireCommands->getCommandBuffer());
+    }
+    commandBuffers.push_back(cmd);
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if (recording->transferDone != VK_NULL_HANDLE) {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &recording->transferDone;
+        submitInfo.pWaitDstStageMask = &waitStage;
+    }
+    submitInfo.commandBufferCount =
+        static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+
+    recording->fence = obtainFence();
+    if (device->submitToAvailableGraphicsQueue(&submitInfo, recording->fence) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload batch!");
+    }
+
+    lastSubmitted = recording->token;
+    inFlight.push_back(std::move(recording));
+
+    return lastSubmitted;
+}
+
+void UploadContext::submitOwnershipTransfers() {
+    auto &batch = *recording;
+
+    if (!batch.bufferReleases.empty() || !batch.imageReleases.empty()) {
+        vkCmdPipelineBarrier(
+            batch.transferCommands->getCommandBuffer(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+            static_cast<uint32_t>(batch.bufferReleases.size()),
+            batch.bufferReleases.data(),
+            static_cast<uint32_t>(batch.imageReleases.size()),
+            batch.imageReleases.data());
+    }
+    batch.transferCommands->end();
+
+    batch.transferDone = obtainSemaphore();
+    auto transferCmd = batch.transferCommands->getCommandBuffer();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &transferCmd;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &batch.transferDone;
+
+    if (device->submitToTransferQueue(&submitInfo, VK_NULL_HANDLE) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit transfer batch!");
+    }
+
+    // The acquire half has to repeat the release barriers exactly, only the
+    // access masks differ
+    if (batch.bufferReleases.empty() && batch.imageReleases.empty()) {
+        return;
+    }
+
+    auto bufferAcquires = batch.bufferReleases;
+    for (auto &acquire : bufferAcquires) {
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = uploadConsumerAccess;
+    }
+
+    auto imageAcquires = batch.imageReleases;
+    for (auto &acquire : imageAcquires) {
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+
+    batch.acquireCommands = obtainCommandBuffer(false);
+    batch.acquireCommands->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkCmdPipelineBarrier(batch.acquireCommands->getCommandBuffer(),
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         uploadConsumerStages, 0, 0, nullptr,
+                         static_cast<uint32_t>(bufferAcquires.size()),
+                         bufferAcquires.data(),
+                         static_cast<uint32_t>(imageAcquires.size()),
+                         imageAcquires.data());
+    batch.acquireCommands->end();
+}
+
+void UploadContext::releaseBuffer(Buffer &buffer, VkDeviceSize offset,
+                                  VkDeviceSize size) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = device->getTransferQueueFamily();
+    barrier.dstQueueFamilyIndex = device->getGraphicsQueueFamily();
+    barrier.buffer = buffer.getBuffer();
+    barrier.offset = offset;
+    barrier.size = size;
+
+    recording->bufferReleases.push_back(barrier);
+}
+
+void UploadContext::releaseImage(Image &image) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = device->getTransferQueueFamily();
+    barrier.dstQueueFamilyIndex = device->getGraphicsQueueFamily();
+    barrier.image = image.getVkImage();
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    recording->imageReleases.push_back(barrier);
+}
+
+bool UploadContext::isComplete(UploadToken token) {
+    retireCompleted();
+    return token <= lastCompleted;
+}
+
+void UploadContext::wait(UploadToken token) {
+    if (recording && token >= recording->token) {
+        submit();
+    }
+
+    while (!inFlight.empty() && inFlight.front()->token <= token) {
+        vkWaitForFences(*device->getDevice(), 1, &inFlight.front()->fence,
+                        VK_TRUE, UINT64_MAX);
+        lastCompleted = inFlight.front()->token;
+        recycle(std::move(inFlight.front()));
+        inFlight.pop_front();
+    }
+}
+
+void UploadContext::waitAll() { wait(submit()); }
+
+void UploadContext::beginBatch() {
+    retireCompleted();
+
+    auto batch = std::make_unique<Batch>();
+    batch->token = nextToken++;
+    batch->graphicsCommands = obtainCommandBuffer(false);
+    batch->graphicsCommands->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    recording = std::move(batch);
+}
+
+void UploadContext::retireCompleted() {
+    // every batch ends on the graphics queue, so they complete in order
+    while (!inFlight.empty() &&
+           vkGetFenceStatus(*device->getDevice(), inFlight.front()->fence) ==
+               VK_SUCCESS) {
+        lastCompleted = inFlight.front()->token;
+        recycle(std::move(inFlight.front()));
+        inFlight.pop_front();
+    }
+}
+
+void UploadContext::recycle(std::unique_ptr<Batch> batch) {
+    stagingRing->release(batch->token);
+
+    vkResetFences(*device->getDevice(), 1, &batch->fence);
+    freeFences.push_back(batch->fence);
+
+    if (batch->transferDone != VK_NULL_HANDLE) {
+        freeSemaphores.push_back(batch->transferDone);
+    }
+
+    if (batch->transferCommands) {
+        freeTransferCommandBuffers.push_back(
+            std::move(batch->transferCommands));
+    }
+    if (batch->acquireCommands) {
+        freeGraphicsCommandBuffers.push_back(
+            std::move(batch->acquireCommands));
+    }
+    freeGraphicsCommandBuffers.push_back(std::move(batch->graphicsCommands));
+    // staging buffers are released together with the batch
+}
+
+std::unique_ptr<CommandBuffer>
+UploadContext::obtainCommandBuffer(bool transfer) {
+    auto &freeList =
+        transfer ? freeTransferCommandBuffers : freeGraphicsCommandBuffers;
+
+    if (!freeList.empty()) {
+        auto commandBuffer = std::move(freeList.back());
+        freeList.pop_back();
+        commandBuffer->reset();
+        return commandBuffer;
+    }
+
+    auto pool = transfer ? device->getTransferCommandPool()
+                         : device->getGraphicsCommandPool();
+    return std::make_unique<CommandBuffer>(device, pool);
+}
+
+VkFence UploadContext::obtainFence() {
+    if (!freeFences.empty()) {
+        auto fence = freeFences.back();
+        freeFences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if (vkCreateFence(*device->getDevice(), &fenceInfo, nullptr, &fence) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload fence!");
+    }
+    return fence;
+}
+
+VkSemaphore UploadContext::obtainSemaphore() {
+    if (!freeSemaphores.empty()) {
+        auto semaphore = freeSemaphores.back();
+        freeSemaphores.pop_back();
+        return semaphore;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(*device->getDevice(), &semaphoreInfo, nullptr,
+                          &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload semaphore!");
+    }
+    return semaphore;
+}
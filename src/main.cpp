@@ -41,11 +41,8 @@ int main(int argc, char *argv[]) {
             VkExtent2D swapChainExtent = swapChain.getExtent();
 
             ubo.view = camera->GetViewMatrix();
-            ubo.proj = glm::perspective(glm::radians(camera->getZoom()),
-                                        swapChainExtent.width /
-                                            (float)swapChainExtent.height,
-                                        0.1f, 1000.0f);
-            ubo.proj[1][1] *= -1;
+            ubo.proj = camera->getProjectionMatrix(
+                swapChainExtent.width / (float)swapChainExtent.height);
 
             ubo.camPos = glm::vec4{camera->Position, 0.0};
         };
@@ -58,7 +55,7 @@ int main(int argc, char *argv[]) {
 
         SceneLighting staticLighting{*engine.getDevice(), 3};
 
-        PipelineSettings shading("shaders/vert.spv", "shaders/frag.spv");
+        PipelineSettings shading(SHADER_DIR "vert.spv", SHADER_DIR "frag.spv");
         shading.bind(uniformAttachment);
         shading.bind(resolutionsAttachment);
         shading.bind(textureAttachment);